@@ -0,0 +1,75 @@
+#version 450 core
+out vec4 FragColor;
+in vec2 TexCoords;
+
+uniform sampler2D srcTexture;
+uniform bool firstPass;  // bright pass + Karis average, scene -> mip 0
+uniform float threshold; // luminance where bloom starts
+uniform float knee;      // soft transition width around the threshold
+
+float Luminance(vec3 c) {
+    return dot(c, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// quadratic soft knee, keeps the bright pass free of hard edges
+vec3 BrightPass(vec3 c) {
+    float brightness = Luminance(c);
+    float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4.0 * knee + 1e-4);
+    float contribution = max(soft, brightness - threshold) / max(brightness, 1e-4);
+    return c * contribution;
+}
+
+// weight by 1 / (1 + luma): a single very bright pixel cannot flicker through the chain
+float KarisWeight(vec3 c) {
+    return 1.0 / (1.0 + Luminance(c));
+}
+
+// 13-tap downsample (Jimenez, "Next Generation Post Processing in Call of Duty: Advanced Warfare"):
+// 4 overlapping 2x2 boxes + a center box, bilinear taps
+void main()
+{
+    vec2 texel = 1.0 / vec2(textureSize(srcTexture, 0));
+
+    vec3 a = texture(srcTexture, TexCoords + texel * vec2(-2.0,  2.0)).rgb;
+    vec3 b = texture(srcTexture, TexCoords + texel * vec2( 0.0,  2.0)).rgb;
+    vec3 c = texture(srcTexture, TexCoords + texel * vec2( 2.0,  2.0)).rgb;
+    vec3 d = texture(srcTexture, TexCoords + texel * vec2(-2.0,  0.0)).rgb;
+    vec3 e = texture(srcTexture, TexCoords).rgb;
+    vec3 f = texture(srcTexture, TexCoords + texel * vec2( 2.0,  0.0)).rgb;
+    vec3 g = texture(srcTexture, TexCoords + texel * vec2(-2.0, -2.0)).rgb;
+    vec3 h = texture(srcTexture, TexCoords + texel * vec2( 0.0, -2.0)).rgb;
+    vec3 i = texture(srcTexture, TexCoords + texel * vec2( 2.0, -2.0)).rgb;
+    vec3 j = texture(srcTexture, TexCoords + texel * vec2(-1.0,  1.0)).rgb;
+    vec3 k = texture(srcTexture, TexCoords + texel * vec2( 1.0,  1.0)).rgb;
+    vec3 l = texture(srcTexture, TexCoords + texel * vec2(-1.0, -1.0)).rgb;
+    vec3 m = texture(srcTexture, TexCoords + texel * vec2( 1.0, -1.0)).rgb;
+
+    vec3 result;
+    if (firstPass) {
+        vec3 boxes[5] = vec3[5](
+            (j + k + l + m) * 0.25,
+            (a + b + d + e) * 0.25,
+            (b + c + e + f) * 0.25,
+            (d + e + g + h) * 0.25,
+            (e + f + h + i) * 0.25);
+        float weights[5] = float[5](0.5, 0.125, 0.125, 0.125, 0.125);
+
+        result = vec3(0.0);
+        float total = 0.0;
+        for (int n = 0; n < 5; n++) {
+            vec3 bright = BrightPass(boxes[n]);
+            float w = weights[n] * KarisWeight(bright);
+            result += bright * w;
+            total += w;
+        }
+        result /= max(total, 1e-4);
+    }
+    else {
+        result = e * 0.125;
+        result += (a + c + g + i) * 0.03125;
+        result += (b + d + f + h) * 0.0625;
+        result += (j + k + l + m) * 0.125;
+    }
+    FragColor = vec4(max(result, vec3(0.0)), 1.0);
+}
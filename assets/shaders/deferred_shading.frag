@@ -1,7 +1,6 @@
 #version 450 core
 
-layout (location = 0) out vec4 FragColor;
-layout (location = 1) out vec4 BrightColor;
+layout (location = 0) out vec4 FragColor; // bloom thresholds it in its first downsample
 
 in vec2 TexCoords;
 
@@ -10,63 +9,61 @@ uniform sampler2D gNormal;
 uniform sampler2D gAlbedoSpec;
 uniform sampler2D ssao;
 uniform sampler2D gEmission;
+uniform sampler3D fogVolume; // integrated froxel fog: rgb in-scattering, a transmittance
+uniform sampler2D gDepth;    // compact G-buffer only
 
-struct Light {
-    vec3 Position;
-    vec3 Color;
-    float Linear;
-    float Quadratic;
-};
+// Variants (LIGHTING_* in DeferredRenderer.h): COMPACT_GBUFFER (position from depth, octahedral normals),
+// SURFACE_LIGHTS (clustered point lights, otherwise added by the light volume pass), AMBIENT_OCCLUSION
+#include "include/lights.glsl"
+#include "include/clusters.glsl"
+#include "include/octahedral.glsl"
+#include "include/fog.glsl"
 
-const int NR_LIGHTS = 100;
-uniform Light lights[NR_LIGHTS];
 uniform vec3 viewPos;
 
-// volumetric fog params
-const float FOG_DENSITY = 0.04;
-const float FOG_HEIGHT_FALLOFF = 0.25;
-const float FOG_HEIGHT_OFFSET = -1.0;
-
-float ComputeFogIntegral(vec3 camPos, vec3 worldPos) {
-    vec3 camToPoint = worldPos - camPos;
-    float distance = length(camToPoint);
-    float heightDiff = worldPos.y - camPos.y;
-    
-    if (abs(heightDiff) < 0.0001) heightDiff = 0.0001;
-
-    float num = FOG_DENSITY * distance;
-    float den = heightDiff * FOG_HEIGHT_FALLOFF;
-    
-    float valA = exp(-((camPos.y - FOG_HEIGHT_OFFSET) * FOG_HEIGHT_FALLOFF));
-    float valB = exp(-((worldPos.y - FOG_HEIGHT_OFFSET) * FOG_HEIGHT_FALLOFF));
-    
-    float fogAmount = (num / den) * (valA - valB);
-    return max(fogAmount, 0.0);
+// cluster lookup
+uniform mat4 view;
+uniform float zNear;
+uniform float zFar;
+uniform float tanHalfFovY;
+uniform float aspect;
+
+// view-space position from the depth buffer and the pixel's view ray
+vec3 ViewPositionFromDepth(vec2 uv, float depth) {
+    float ndcZ = depth * 2.0 - 1.0;
+    float linearDepth = 2.0 * zNear * zFar / (zFar + zNear - ndcZ * (zFar - zNear));
+    vec2 ndc = uv * 2.0 - 1.0;
+    return vec3(ndc.x * tanHalfFovY * aspect, ndc.y * tanHalfFovY, -1.0) * linearDepth;
 }
 
-vec3 ComputeFogColor(vec3 viewDir, vec3 moonDir, vec3 baseFogColor) {
-    float sunAmount = max(dot(viewDir, moonDir), 0.0);
-    vec3 fogHighlightColor = vec3(0.6, 0.7, 0.9); 
-    float scatterPower = pow(sunAmount, 8.0); 
-    return mix(baseFogColor, fogHighlightColor, scatterPower * 0.5);
+// returns false for sky pixels
+bool ReadGBuffer(vec2 uv, out vec3 worldPos, out vec3 normal) {
+#ifdef COMPACT_GBUFFER
+    float depth = texture(gDepth, uv).r;
+    worldPos = viewPos + transpose(mat3(view)) * ViewPositionFromDepth(uv, depth);
+    normal = OctDecode(texture(gNormal, uv).rg);
+    return depth < 1.0;
+#else
+    worldPos = texture(gPosition, uv).rgb;
+    normal = texture(gNormal, uv).rgb;
+    return length(normal) > 0.1;
+#endif
 }
 
 void main()
 {
-    vec3 FragPos = texture(gPosition, TexCoords).rgb;
-    vec3 Normal = texture(gNormal, TexCoords).rgb;
+    vec3 FragPos;
+    vec3 Normal;
+    bool isGeometry = ReadGBuffer(TexCoords, FragPos, Normal);
     vec3 Diffuse = texture(gAlbedoSpec, TexCoords).rgb;
     float Specular = texture(gAlbedoSpec, TexCoords).a;
     vec3 Emission = texture(gEmission, TexCoords).rgb;
     
+#ifdef AMBIENT_OCCLUSION
     float AmbientOcclusion = texture(ssao, TexCoords).r;
-
-    bool isGeometry = length(Normal) > 0.1;
-
-    float fragDist = length(FragPos - viewPos);
-    if (!isGeometry) {
-        fragDist = 1000.0; 
-    }
+#else
+    float AmbientOcclusion = 1.0; // AO pass culled at this quality tier
+#endif
 
     vec3 lighting = vec3(0.0);
 
@@ -81,45 +78,42 @@ void main()
         lighting = ambient;
     }
 
-    vec3 viewDir = normalize(FragPos - viewPos); 
-    vec3 volumetricFog = vec3(0.0);
-
-    for(int i = 0; i < NR_LIGHTS; ++i)
-    {
-        float lightDist = length(lights[i].Position - viewPos);
-
-        // suface illu
-        if(isGeometry) {
-            float distance = length(lights[i].Position - FragPos);
-            if(distance < 15.0) { 
-                vec3 lightDir = normalize(lights[i].Position - FragPos);
-                vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Diffuse * lights[i].Color;
-                
-                vec3 halfwayDir = normalize(lightDir + viewDir);  
-                float spec = pow(max(dot(Normal, halfwayDir), 0.0), 16.0);
-                vec3 specular = lights[i].Color * spec * Specular;
-                
-                float attenuation = 1.0 / (1.0 + lights[i].Linear * distance + lights[i].Quadratic * distance * distance);
-                
-                lighting += (diffuse + specular) * attenuation;
-            }
-        }
+    vec3 viewDir = normalize(FragPos - viewPos);
 
-        // Volumetric Scattering
-        if (lightDist < fragDist) 
+    // sky has no position, rebuild its view ray
+    vec2 ndc = TexCoords * 2.0 - 1.0;
+    vec3 viewRay = vec3(ndc.x * tanHalfFovY * aspect, ndc.y * tanHalfFovY, -1.0);
+    if (!isGeometry) {
+        viewDir = normalize(transpose(mat3(view)) * viewRay);
+    }
+
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / vec2(textureSize(gNormal, 0)) * vec2(CLUSTER_GRID.xy)), CLUSTER_GRID.xy - 1u);
+    float fragDepth = isGeometry ? -(view * vec4(FragPos, 1.0)).z : zFar;
+    uint fragSlice = GetClusterSlice(fragDepth, zNear, zFar);
+
+#ifdef SURFACE_LIGHTS
+    // suface illu: only lights binned into this pixel's cluster
+    if (isGeometry) {
+        uvec2 cluster = clusters[GetClusterIndex(tile, fragSlice)];
+        for (uint n = 0u; n < cluster.y; ++n)
         {
-            vec3 lightToCamDir = normalize(lights[i].Position - viewPos);
-            float cosTheta = dot(viewDir, lightToCamDir);
-            
-            if (cosTheta > 0.0) 
-            {
-                float haloFalloff = 100.0;
-                float scattering = pow(cosTheta, haloFalloff);
-                scattering *= 1.0 / (1.0 + lightDist * 0.2);
-                volumetricFog += lights[i].Color * scattering * 1.0;
+            Light light = lights[lightIndices[cluster.x + n]];
+            float distance = length(light.Position - FragPos);
+            if (distance < light.Radius) {
+                vec3 lightDir = normalize(light.Position - FragPos);
+                vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Diffuse * light.Color;
+
+                vec3 halfwayDir = normalize(lightDir + viewDir);
+                float spec = pow(max(dot(Normal, halfwayDir), 0.0), 16.0);
+                vec3 specular = light.Color * spec * Specular;
+
+                float attenuation = 1.0 / (1.0 + light.Linear * distance + light.Quadratic * distance * distance);
+
+                lighting += (diffuse + specular) * attenuation;
             }
         }
     }
+#endif
 
     // moon lighting
     vec3 moonDir = normalize(vec3(0.5, 1.0, 0.3)); 
@@ -136,29 +130,26 @@ void main()
         lighting += Emission;
     }
 
-    lighting += volumetricFog; 
+    // Volumetric Fog: one fetch from the froxel volume (height fog + light scattering)
+    float fogSlices = float(textureSize(fogVolume, 0).z);
+    float froxelSlice = log(max(fragDepth, zNear) / zNear) / log(zFar / zNear) * fogSlices;
+    vec4 fog = texture(fogVolume, vec3(TexCoords, (froxelSlice - 0.5) / fogSlices));
+    vec3 inScattering = fog.rgb;
+    float fogTransmittance = fog.a;
 
-    // Global Volumetric Fog
-    vec3 fogTargetPos = FragPos;
     if (!isGeometry) {
-        fogTargetPos = viewPos + normalize(FragPos - viewPos) * 500.0;  // very far sky
+        // the volume ends at zFar, add the analytic height fog out to the very far sky
+        vec3 farPos = viewPos + viewDir * (zFar * length(viewRay));
+        vec3 skyPos = viewPos + viewDir * 500.0;
+        float tailTransmittance = exp(-ComputeFogIntegral(farPos, skyPos));
+
+        vec3 baseFogColor = vec3(0.15, 0.05, 0.2);
+        vec3 finalFogColor = ComputeFogColor(viewDir, moonDir, baseFogColor);
+        inScattering += fogTransmittance * finalFogColor * (1.0 - tailTransmittance);
+        fogTransmittance *= tailTransmittance;
     }
 
-    float fogIntegral = ComputeFogIntegral(viewPos, fogTargetPos);
-    float fogTransmittance = exp(-fogIntegral);
-
-    vec3 baseFogColor = vec3(0.15, 0.05, 0.2); 
-    vec3 finalFogColor = ComputeFogColor(viewDir, moonDir, baseFogColor);
-
-    vec3 finalColor = mix(finalFogColor, lighting, fogTransmittance);
+    vec3 finalColor = lighting * fogTransmittance + inScattering;
 
     FragColor = vec4(finalColor, 1.0);
-
-    // Bloom
-    float brightness = dot(finalColor, vec3(0.2126, 0.7152, 0.0722));
-    float threshold = 2.0; 
-    if(brightness > threshold)
-        BrightColor = vec4(finalColor, 1.0);
-    else
-        BrightColor = vec4(0.0, 0.0, 0.0, 1.0);
 }
\ No newline at end of file
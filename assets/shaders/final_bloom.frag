@@ -3,8 +3,16 @@ out vec4 FragColor;
 in vec2 TexCoords;
 
 uniform sampler2D scene;      // HDR Scene
-uniform sampler2D bloomBlur;  // blurreds bloom
-uniform float exposure;
+uniform sampler2D bloomBlur;  // blurreds bloom (half resolution, bilinear upscaled)
+uniform float exposure;       // manual exposure
+uniform bool autoExposure;
+
+// written by luminance_average.comp
+layout (std430, binding = 3) readonly buffer Exposure {
+    float averageLuminance;
+    float adaptedExposure;
+};
+uniform float bloomIntensity;
 
 void main()
 {             
@@ -12,10 +20,10 @@ void main()
     vec3 bloomColor = texture(bloomBlur, TexCoords).rgb;
     
     // Additive Blending
-    hdrColor += bloomColor;
+    hdrColor += bloomColor * bloomIntensity;
 
     // Tone Mapping
-    vec3 result = vec3(1.0) - exp(-hdrColor * exposure);
+    vec3 result = vec3(1.0) - exp(-hdrColor * (autoExposure ? adaptedExposure : exposure));
     
     // Gamma Correction
     const float gamma = 2.2;
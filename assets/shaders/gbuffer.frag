@@ -11,6 +11,9 @@ in vec2 TexCoords;
 
 uniform vec3 objectColor;
 uniform sampler2D normalMap;
+uniform bool compactGBuffer; // no position target, octahedral normals
+
+#include "include/octahedral.glsl"
 
 float random(vec2 st) {
     return fract(sin(dot(st.xy, vec2(12.9898,78.233))) * 43758.5453123);
@@ -58,7 +61,7 @@ void main()
     gPosition = vec4(FragPos, 1.0);
     vec3 geometricNormal = normalize(Normal);
     vec3 detailedNormal = getTriplanarNormal(FragPos, geometricNormal, 1.0);
-    gNormal = detailedNormal;
+    gNormal = compactGBuffer ? vec3(OctEncode(detailedNormal), 0.0) : detailedNormal;
     
     vec3 baseColor = vec3(0.05, 0.05, 0.07);    // gray
     gAlbedoSpec.rgb = baseColor;
@@ -1,7 +1,7 @@
 #version 450 core
 
 layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec3 aNormal;
+layout (location = 1) in vec2 aNormal; // octahedral
 layout (location = 2) in vec2 aTexCoords;
 layout (location = 3) in mat4 instanceMatrix;
 
@@ -12,6 +12,8 @@ out vec2 TexCoords;
 uniform mat4 view;
 uniform mat4 projection;
 
+#include "include/octahedral.glsl"
+
 void main()
 {
     vec4 worldPos = instanceMatrix * vec4(aPos, 1.0);
@@ -19,8 +21,11 @@ void main()
     
     TexCoords = aTexCoords;
     
-    mat3 normalMatrix = transpose(inverse(mat3(instanceMatrix)));
-    Normal = normalMatrix * aNormal;
+    // cofactor matrix = det * inverse-transpose, the fragment shader normalizes anyway
+    mat3 m = mat3(instanceMatrix);
+    mat3 cofactor = mat3(cross(m[1], m[2]), cross(m[2], m[0]), cross(m[0], m[1]));
+    float handedness = dot(m[0], cofactor[0]) < 0.0 ? -1.0 : 1.0;
+    Normal = cofactor * OctDecode(aNormal) * handedness;
 
     gl_Position = projection * view * worldPos;
 }
\ No newline at end of file
@@ -0,0 +1,31 @@
+#version 450 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aNormal; // octahedral
+layout (location = 2) in vec2 aTexCoords;
+// CompactInstance: translation + scale only
+layout (location = 3) in vec3 instancePosition;
+layout (location = 4) in uint instanceMaterial;
+layout (location = 5) in vec3 instanceScale;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+#include "include/octahedral.glsl"
+
+void main()
+{
+    vec4 worldPos = vec4(aPos * instanceScale + instancePosition, 1.0);
+    FragPos = worldPos.xyz;
+
+    TexCoords = aTexCoords;
+
+    // inverse-transpose of a diagonal matrix is 1 / scale
+    Normal = OctDecode(aNormal) / instanceScale;
+
+    gl_Position = projection * view * worldPos;
+}
@@ -0,0 +1,16 @@
+// Light cluster lists uploaded by DeferredRenderer (CLUSTER_SSBO_BINDING, LIGHT_INDEX_SSBO_BINDING)
+layout (std430, binding = 1) readonly buffer ClusterData { uvec2 clusters[]; };  // offset, count
+layout (std430, binding = 2) readonly buffer LightIndexData { uint lightIndices[]; };
+
+// cluster grid (must match LightClusters)
+const uvec3 CLUSTER_GRID = uvec3(16, 9, 24);
+
+// view-space depth -> exponential Z slice, same split as LightClusters::GetSlice
+uint GetClusterSlice(float depth, float zNear, float zFar) {
+    float s = log(max(depth, zNear) / zNear) / log(zFar / zNear) * float(CLUSTER_GRID.z);
+    return min(uint(s), CLUSTER_GRID.z - 1u);
+}
+
+uint GetClusterIndex(uvec2 tile, uint slice) {
+    return tile.x + CLUSTER_GRID.x * (tile.y + CLUSTER_GRID.y * slice);
+}
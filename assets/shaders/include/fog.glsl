@@ -0,0 +1,29 @@
+// Height fog shared by the froxel injection and the sky tail of the lighting pass
+const float FOG_DENSITY = 0.04;
+const float FOG_HEIGHT_FALLOFF = 0.25;
+const float FOG_HEIGHT_OFFSET = -1.0;
+
+// optical depth of the height fog between two points
+float ComputeFogIntegral(vec3 camPos, vec3 worldPos) {
+    vec3 camToPoint = worldPos - camPos;
+    float distance = length(camToPoint);
+    float heightDiff = worldPos.y - camPos.y;
+
+    if (abs(heightDiff) < 0.0001) heightDiff = 0.0001;
+
+    float num = FOG_DENSITY * distance;
+    float den = heightDiff * FOG_HEIGHT_FALLOFF;
+
+    float valA = exp(-((camPos.y - FOG_HEIGHT_OFFSET) * FOG_HEIGHT_FALLOFF));
+    float valB = exp(-((worldPos.y - FOG_HEIGHT_OFFSET) * FOG_HEIGHT_FALLOFF));
+
+    float fogAmount = (num / den) * (valA - valB);
+    return max(fogAmount, 0.0);
+}
+
+vec3 ComputeFogColor(vec3 viewDir, vec3 moonDir, vec3 baseFogColor) {
+    float sunAmount = max(dot(viewDir, moonDir), 0.0);
+    vec3 fogHighlightColor = vec3(0.6, 0.7, 0.9);
+    float scatterPower = pow(sunAmount, 8.0);
+    return mix(baseFogColor, fogHighlightColor, scatterPower * 0.5);
+}
@@ -0,0 +1,10 @@
+// std430 mirror of PointLight (PointLight.h), LIGHT_SSBO_BINDING
+struct Light {
+    vec3 Position;
+    float Radius;
+    vec3 Color;
+    float Linear;
+    float Quadratic;
+};
+
+layout (std430, binding = 0) readonly buffer LightData { Light lights[]; };
@@ -2,11 +2,33 @@
 
 layout (location = 0) in vec3 aPos;
 
-uniform mat4 model;
+#include "include/lights.glsl"
+
+flat out vec3 LightColor;
+
 uniform mat4 view;
 uniform mat4 projection;
+uniform vec3 viewPos;
+uniform float proxySize;
+uniform float maxDistance;
+uniform vec4 frustumPlanes[6];
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-}
\ No newline at end of file
+    // one instance per light
+    Light light = lights[gl_InstanceID];
+    LightColor = light.Color;
+
+    // culled: every vertex of the instance lands on the same point outside the clip volume
+    bool visible = distance(light.Position, viewPos) <= maxDistance;
+    float boundingRadius = proxySize * 0.8660254; // half diagonal of the unit cube * size
+    for (int i = 0; i < 6; i++)
+        visible = visible && dot(frustumPlanes[i].xyz, light.Position) + frustumPlanes[i].w >= -boundingRadius;
+    if (!visible) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+
+    vec3 worldPos = light.Position + aPos * proxySize;
+    gl_Position = projection * view * vec4(worldPos, 1.0);
+}
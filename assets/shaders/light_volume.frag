@@ -0,0 +1,80 @@
+#version 450 core
+
+layout (location = 0) out vec4 FragColor;
+
+flat in int LightIndex;
+
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+
+#include "include/lights.glsl"
+#include "include/octahedral.glsl"
+
+uniform vec3 viewPos;
+
+// integrated froxel fog (same volume as deferred_shading.frag)
+uniform sampler3D fogVolume;
+uniform mat4 view;
+uniform float zNear;
+uniform float zFar;
+
+// COMPACT_GBUFFER variant: position from depth, octahedral normals
+uniform sampler2D gDepth;
+uniform float tanHalfFovY;
+uniform float aspect;
+
+// returns false for sky pixels
+bool ReadGBuffer(ivec2 pixel, vec2 uv, out vec3 worldPos, out vec3 normal) {
+#ifdef COMPACT_GBUFFER
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    float ndcZ = depth * 2.0 - 1.0;
+    float linearDepth = 2.0 * zNear * zFar / (zFar + zNear - ndcZ * (zFar - zNear));
+    vec2 ndc = uv * 2.0 - 1.0;
+    vec3 viewSpace = vec3(ndc.x * tanHalfFovY * aspect, ndc.y * tanHalfFovY, -1.0) * linearDepth;
+    worldPos = viewPos + transpose(mat3(view)) * viewSpace;
+    normal = OctDecode(texelFetch(gNormal, pixel, 0).rg);
+    return depth < 1.0;
+#else
+    worldPos = texelFetch(gPosition, pixel, 0).rgb;
+    normal = texelFetch(gNormal, pixel, 0).rgb;
+    return length(normal) > 0.1;
+#endif
+}
+
+float FogTransmittance(vec2 uv, vec3 worldPos) {
+    float depth = max(-(view * vec4(worldPos, 1.0)).z, zNear);
+    float slices = float(textureSize(fogVolume, 0).z);
+    float s = log(depth / zNear) / log(zFar / zNear) * slices;
+    return texture(fogVolume, vec3(uv, (s - 0.5) / slices)).a;
+}
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec2 uv = gl_FragCoord.xy / vec2(textureSize(gNormal, 0));
+    vec3 FragPos;
+    vec3 Normal;
+    bool isGeometry = ReadGBuffer(pixel, uv, FragPos, Normal);
+    vec4 AlbedoSpec = texelFetch(gAlbedoSpec, pixel, 0);
+
+    Light light = lights[LightIndex];
+    float distance = length(light.Position - FragPos);
+    if (!isGeometry || distance >= light.Radius) discard;
+
+    vec3 viewDir = normalize(FragPos - viewPos);
+    vec3 lightDir = normalize(light.Position - FragPos);
+    vec3 diffuse = max(dot(Normal, lightDir), 0.0) * AlbedoSpec.rgb * light.Color;
+
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(Normal, halfwayDir), 0.0), 16.0);
+    vec3 specular = light.Color * spec * AlbedoSpec.a;
+
+    float attenuation = 1.0 / (1.0 + light.Linear * distance + light.Quadratic * distance * distance);
+
+    // the full-screen pass applies fog as lighting * T + scattering, so light volumes just scale by T
+    float fogTransmittance = FogTransmittance(uv, FragPos);
+    vec3 result = (diffuse + specular) * attenuation * fogTransmittance;
+
+    FragColor = vec4(result, 1.0);
+}
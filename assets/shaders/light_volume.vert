@@ -0,0 +1,19 @@
+#version 450 core
+
+layout (location = 0) in vec3 aPos;
+
+#include "include/lights.glsl"
+
+flat out int LightIndex;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    // unit bounding sphere, one instance per light
+    Light light = lights[gl_InstanceID];
+    LightIndex = gl_InstanceID;
+    vec3 worldPos = light.Position + aPos * light.Radius;
+    gl_Position = projection * view * vec4(worldPos, 1.0);
+}
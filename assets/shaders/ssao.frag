@@ -1,34 +1,61 @@
 #version 450 core
-out float FragColor;
+out vec2 FragColor; // AO, linear depth (for the bilateral blur / upsample)
 
 in vec2 TexCoords;
 
 uniform sampler2D gPosition; // World Space
 uniform sampler2D gNormal;   // World Space
 uniform sampler2D texNoise;  // 4x4 Noise
+uniform sampler2D gDepth;    // COMPACT_GBUFFER variant: depth, octahedral normals in gNormal
 
-uniform vec3 samples[64]; // Kernel
+// Kernel, uploaded once by SSAO (xyz, w unused)
+layout (std140, binding = 0) uniform SSAOKernel {
+    vec4 samples[64];
+};
+#ifdef KERNEL_SIZE
+const int kernelSize = KERNEL_SIZE; // specialized variant, the loop is unrolled
+#else
+uniform int kernelSize;
+#endif
+uniform vec2 noiseScale; // AO resolution / 4 (noise is 4x4)
 uniform mat4 projection;
 uniform mat4 view;        // Ψ World -> View
 
 // Ѽ (iq C++ վ)
-int kernelSize = 64;
 float radius = 0.5; // ļ˥b| (ӤpSĪGAӤj|T)
 float bias = 0.025; // קKۧھBq
 
+#include "include/octahedral.glsl"
+
+// view-space position, rebuilt from depth with the projection matrix in the compact layout
+vec3 ViewPosition(vec2 uv) {
+#ifdef COMPACT_GBUFFER
+    float ndcZ = texture(gDepth, uv).r * 2.0 - 1.0;
+    float viewZ = -projection[3][2] / (ndcZ + projection[2][2]);
+    vec2 ndc = uv * 2.0 - 1.0;
+    return vec3(-viewZ * ndc.x / projection[0][0], -viewZ * ndc.y / projection[1][1], viewZ);
+#else
+    return vec3(view * vec4(texture(gPosition, uv).rgb, 1.0));
+#endif
+}
+
+vec3 ViewNormal(vec2 uv) {
+#ifdef COMPACT_GBUFFER
+    vec3 worldNormal = OctDecode(texture(gNormal, uv).rg);
+#else
+    vec3 worldNormal = texture(gNormal, uv).rgb;
+#endif
+    return normalize(mat3(view) * worldNormal);
+}
+
 void main()
 {
     // 1. Ū G-Buffer ഫ View Space
-    vec3 worldPos = texture(gPosition, TexCoords).rgb;
-    vec3 worldNormal = texture(gNormal, TexCoords).rgb;
-    
     //  Gഫ View Space
-    vec3 fragPos = vec3(view * vec4(worldPos, 1.0));
-    vec3 normal = normalize(mat3(view) * worldNormal);
+    vec3 fragPos = ViewPosition(TexCoords);
+    vec3 normal = ViewNormal(TexCoords);
 
     // 2. إ TBN x} (ļˮH)
-    // ùѪRװH 4 (]nϬO 4x4)
-    vec2 noiseScale = textureSize(gPosition, 0) / 4.0; 
     vec3 randomVec = texture(texNoise, TexCoords * noiseScale).xyz;
     
     vec3 tangent = normalize(randomVec - normal * dot(randomVec, normal));
@@ -40,7 +67,7 @@ void main()
     for(int i = 0; i < kernelSize; ++i)
     {
         // oļIm (View Space)
-        vec3 samplePos = TBN * samples[i]; 
+        vec3 samplePos = TBN * samples[i].xyz; 
         samplePos = fragPos + samplePos * radius; 
         
         // v Screen Space (o UV y)
@@ -50,8 +77,7 @@ void main()
         offset.xyz = offset.xyz * 0.5 + 0.5; // ܴ 0.0 - 1.0
         
         // ŪӱļIڲ` (q G-Buffer)
-        vec3 sampleWorldPos = texture(gPosition, offset.xy).rgb;
-        float sampleDepth = (view * vec4(sampleWorldPos, 1.0)).z; //  View Space Z
+        float sampleDepth = ViewPosition(offset.xy).z; //  View Space Z
         
         // dˬd (Range Check)GpG`׮tӻANӤ۾B
         float rangeCheck = smoothstep(0.0, 1.0, radius / abs(fragPos.z - sampleDepth));
@@ -63,5 +89,5 @@ void main()
     }
     
     occlusion = 1.0 - (occlusion / kernelSize);
-    FragColor = occlusion;
+    FragColor = vec2(occlusion, -fragPos.z);
 }
\ No newline at end of file
@@ -1,19 +1,45 @@
 #version 450 core
-out float FragColor;
+out vec2 FragColor; // blurred AO, depth passed through
 in vec2 TexCoords;
 
-uniform sampler2D ssaoInput;
+uniform sampler2D ssaoInput; // AO, linear depth
+uniform sampler2D gNormal;   // full resolution, world space
+uniform bool compactGBuffer;
+uniform vec2 direction;      // (1, 0) horizontal, (0, 1) vertical
 
+const int RADIUS = 4;
+const float DEPTH_SHARPNESS = 8.0; // relative depth difference -> weight falloff
+const float NORMAL_POWER = 16.0;
+
+#include "include/octahedral.glsl"
+
+// Zero on sky pixels of the standard layout (cleared normal): those taps get no weight
+vec3 WorldNormal(vec2 uv) {
+    if (compactGBuffer) return OctDecode(texture(gNormal, uv).rg);
+    vec3 n = texture(gNormal, uv).rgb;
+    return length(n) > 0.1 ? normalize(n) : vec3(0.0);
+}
+
+// Separable bilateral blur: taps across depth / normal edges get no weight,
+// so the AO of a wall does not bleed into the street behind it
 void main() {
     vec2 texelSize = 1.0 / textureSize(ssaoInput, 0);
+    vec2 center = texture(ssaoInput, TexCoords).rg;
+    vec3 centerNormal = WorldNormal(TexCoords);
+
     float result = 0.0;
-    for (int x = -2; x < 2; ++x) 
-    {
-        for (int y = -2; y < 2; ++y) 
-        {
-            vec2 offset = vec2(float(x), float(y)) * texelSize;
-            result += texture(ssaoInput, TexCoords + offset).r;
-        }
+    float totalWeight = 0.0;
+    for (int i = -RADIUS; i <= RADIUS; ++i) {
+        vec2 uv = TexCoords + direction * texelSize * float(i);
+        vec2 tap = texture(ssaoInput, uv).rg;
+
+        float gaussian = exp(-float(i * i) / (2.0 * 3.0 * 3.0));
+        float depthWeight = exp(-abs(tap.g - center.g) / max(center.g, 1e-3) * DEPTH_SHARPNESS);
+        float normalWeight = pow(max(dot(WorldNormal(uv), centerNormal), 0.0), NORMAL_POWER);
+        float weight = gaussian * depthWeight * normalWeight;
+
+        result += tap.r * weight;
+        totalWeight += weight;
     }
-    FragColor = result / 16.0;
-}
\ No newline at end of file
+    FragColor = vec2(totalWeight > 0.0 ? result / totalWeight : center.r, center.g);
+}
@@ -0,0 +1,50 @@
+#version 450 core
+out float FragColor;
+in vec2 TexCoords;
+
+uniform sampler2D ssaoInput; // low resolution AO, linear depth
+uniform sampler2D gPosition; // standard layout: world position
+uniform sampler2D gDepth;    // compact layout: depth
+uniform bool compactGBuffer;
+uniform mat4 projection;
+uniform mat4 view;
+
+// linear view depth of the full resolution pixel
+float LinearDepth(vec2 uv) {
+    if (compactGBuffer) {
+        float ndcZ = texture(gDepth, uv).r * 2.0 - 1.0;
+        return projection[3][2] / (ndcZ + projection[2][2]);
+    }
+    return -(view * vec4(texture(gPosition, uv).rgb, 1.0)).z;
+}
+
+// Joint bilateral upsample: bilinear weights of the 4 nearest low resolution texels,
+// scaled down by how far their depth is from this pixel's
+void main() {
+    vec2 lowSize = vec2(textureSize(ssaoInput, 0));
+    vec2 coord = TexCoords * lowSize - 0.5;
+    vec2 base = floor(coord);
+    vec2 f = coord - base;
+    float depth = LinearDepth(TexCoords);
+
+    float result = 0.0;
+    float totalWeight = 0.0;
+    float nearestAO = 1.0;
+    float nearestDiff = 1e9;
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 2; ++x) {
+            ivec2 texel = clamp(ivec2(base) + ivec2(x, y), ivec2(0), ivec2(lowSize) - 1);
+            vec2 tap = texelFetch(ssaoInput, texel, 0).rg;
+
+            float bilinear = (x == 0 ? 1.0 - f.x : f.x) * (y == 0 ? 1.0 - f.y : f.y);
+            float diff = abs(tap.g - depth);
+            float weight = bilinear / (1e-3 + diff / max(depth, 1e-3) * 64.0);
+            result += tap.r * weight;
+            totalWeight += weight;
+
+            if (diff < nearestDiff) { nearestDiff = diff; nearestAO = tap.r; }
+        }
+    }
+    // every tap on another surface: take the closest one in depth
+    FragColor = totalWeight > 1e-4 ? result / totalWeight : nearestAO;
+}
@@ -0,0 +1,78 @@
+#include "Frustum.h"
+#include "SimdMath.h"
+#include <cmath>
+
+Frustum::Frustum() {
+    for (int i = 0; i < 6; i++) planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f); // accepts everything
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection) {
+    Update(viewProjection);
+}
+
+void Frustum::Update(const glm::mat4& viewProjection) {
+    // Gribb / Hartmann: planes are sums / differences of the matrix rows (glm is column major)
+    glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+    glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+    glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+    glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+    planes[0] = row3 + row0; // left
+    planes[1] = row3 - row0; // right
+    planes[2] = row3 + row1; // bottom
+    planes[3] = row3 - row1; // top
+    planes[4] = row3 + row2; // near
+    planes[5] = row3 - row2; // far
+
+    for (int i = 0; i < 6; i++)
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+bool Frustum::IntersectsAABB(const glm::vec3& center, const glm::vec3& extent) const {
+    for (int i = 0; i < 6; i++) {
+        glm::vec3 n(planes[i]);
+        // distance of the box corner furthest along the plane normal
+        float d = glm::dot(n, center) + glm::dot(glm::abs(n), extent) + planes[i].w;
+        if (d < 0.0f) return false;
+    }
+    return true;
+}
+
+size_t Frustum::CullAABBs(const float* centerX, const float* centerY, const float* centerZ,
+    const float* extentX, const float* extentY, const float* extentZ,
+    size_t count, uint32_t* visibleIndices) const {
+    __m128 nx[6], ny[6], nz[6], ax[6], ay[6], az[6], w[6];
+    for (int i = 0; i < 6; i++) {
+        nx[i] = _mm_set1_ps(planes[i].x);
+        ny[i] = _mm_set1_ps(planes[i].y);
+        nz[i] = _mm_set1_ps(planes[i].z);
+        ax[i] = _mm_set1_ps(std::fabs(planes[i].x));
+        ay[i] = _mm_set1_ps(std::fabs(planes[i].y));
+        az[i] = _mm_set1_ps(std::fabs(planes[i].z));
+        w[i] = _mm_set1_ps(planes[i].w);
+    }
+
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < count; i += 4) {
+        __m128 cx = _mm_loadu_ps(centerX + i), cy = _mm_loadu_ps(centerY + i), cz = _mm_loadu_ps(centerZ + i);
+        __m128 ex = _mm_loadu_ps(extentX + i), ey = _mm_loadu_ps(extentY + i), ez = _mm_loadu_ps(extentZ + i);
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            __m128 d = _mm_add_ps(_mm_mul_ps(nx[p], cx), _mm_mul_ps(ny[p], cy));
+            d = _mm_add_ps(d, _mm_add_ps(_mm_mul_ps(nz[p], cz), w[p]));
+            d = _mm_add_ps(d, _mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_add_ps(_mm_mul_ps(ay[p], ey), _mm_mul_ps(az[p], ez))));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(d, _mm_setzero_ps()));
+        }
+
+        // compact the surviving lanes
+        int mask = _mm_movemask_ps(inside);
+        while (mask) {
+            int lane = 0;
+            while (!(mask & (1 << lane))) lane++;
+            visibleIndices[visibleCount++] = (uint32_t)(i + lane);
+            mask &= mask - 1;
+        }
+    }
+    return visibleCount;
+}
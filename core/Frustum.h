@@ -0,0 +1,25 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+
+// Six view-frustum planes extracted from a projection * view matrix.
+// A point p is inside plane i when dot(planes[i].xyz, p) + planes[i].w >= 0.
+class Frustum {
+public:
+    glm::vec4 planes[6]; // left, right, bottom, top, near, far (normalized)
+
+    Frustum();
+    Frustum(const glm::mat4& viewProjection);
+
+    void Update(const glm::mat4& viewProjection);
+
+    // Scalar reference test for one center / half-extent box
+    bool IntersectsAABB(const glm::vec3& center, const glm::vec3& extent) const;
+
+    // Tests boxes in SoA layout, 4 at a time (SSE2). count must be a multiple of 4.
+    // Writes the indices of the visible boxes and returns how many there are.
+    size_t CullAABBs(const float* centerX, const float* centerY, const float* centerZ,
+        const float* extentX, const float* extentY, const float* extentZ,
+        size_t count, uint32_t* visibleIndices) const;
+};
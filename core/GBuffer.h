@@ -1,66 +1,97 @@
 #pragma once
 #include <glad/glad.h>
 #include <iostream>
+#include "rendering/RenderTargetPool.h"
 
+enum class GBufferLayout {
+    Standard, // RGBA16F position + RGBA16F normal + RGBA8 albedo/spec + RGB8 emission + depth
+    Compact   // depth (position rebuilt from it) + RG16 octahedral normal + RGBA8 albedo/spec + R11G11B10F emission
+};
+
+// Both layouts keep the same fragment output locations (gbuffer.frag):
+// 0 position, 1 normal, 2 albedo/spec, 3 emission. The compact one has no
+// attachment behind location 0 and stores octahedral normals.
+// The targets come from the render target pool: Acquire() before the geometry pass,
+// Release() after the last reader (depth blit of the forward pass).
 class GBuffer {
 public:
     unsigned int gBuffer;
-    unsigned int gPosition, gNormal, gAlbedoSpec;
+    unsigned int gPosition, gNormal, gAlbedoSpec; // gPosition: standard only
     unsigned int gEmission; // ۵ow
-    unsigned int rboDepth; // `׽w
+    unsigned int gDepth; // `׽w
 
     int width, height;
+    GBufferLayout layout;
 
-    GBuffer(int w, int h) : width(w), height(h) {
+    GBuffer(int w, int h, GBufferLayout layout = GBufferLayout::Standard)
+        : gPosition(0), gNormal(0), gAlbedoSpec(0), gEmission(0), gDepth(0), width(w), height(h), layout(layout), poolGeneration(0) {
+        for (int i = 0; i < TARGET_COUNT; i++) targets[i] = nullptr;
         glGenFramebuffers(1, &gBuffer);
-        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+    }
 
-        // 1. Position
-        glGenTextures(1, &gPosition);
-        glBindTexture(GL_TEXTURE_2D, gPosition);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
+    ~GBuffer() {
+        glDeleteFramebuffers(1, &gBuffer);
+    }
 
-        // 2. Normal
-        glGenTextures(1, &gNormal);
-        glBindTexture(GL_TEXTURE_2D, gNormal);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
+    void Acquire(RenderTargetPool* pool) {
+        bool compact = layout == GBufferLayout::Compact;
+        Release(pool);
 
+        // 1. Position (compact: rebuilt from depth)
+        if (!compact) targets[0] = pool->Acquire({ width, height, GL_RGBA16F, RenderTargetUsage::Color }, GL_NEAREST);
+        // 2. Normal (compact: octahedral, 2 x snorm16)
+        targets[1] = pool->Acquire({ width, height, compact ? (GLenum)GL_RG16_SNORM : (GLenum)GL_RGBA16F, RenderTargetUsage::Color }, GL_NEAREST);
         // 3. Albedo + Specular
-        glGenTextures(1, &gAlbedoSpec);
-        glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gAlbedoSpec, 0);
+        targets[2] = pool->Acquire({ width, height, GL_RGBA8, RenderTargetUsage::Color }, GL_NEAREST);
+        // 4. Emission Buffer (RGB, compact: unclamped HDR in 32 bits)
+        targets[3] = pool->Acquire({ width, height, compact ? (GLenum)GL_R11F_G11F_B10F : (GLenum)GL_RGB8, RenderTargetUsage::Color }, GL_NEAREST);
+        // Depth Buffer (24 bit, blitted into the HDR target)
+        targets[4] = pool->Acquire({ width, height, GL_DEPTH_COMPONENT24, RenderTargetUsage::Depth }, GL_NEAREST);
+
+        unsigned int textures[TARGET_COUNT];
+        for (int i = 0; i < TARGET_COUNT; i++) textures[i] = targets[i] ? targets[i]->texture : 0;
 
-        // 4. Emission Buffer (RGB)
-        glGenTextures(1, &gEmission);
-        glBindTexture(GL_TEXTURE_2D, gEmission);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, gEmission, 0);
+        // re-attach only when the pool handed out different textures (same ids after a free may be new storage)
+        if (textures[0] != gPosition || textures[1] != gNormal || textures[2] != gAlbedoSpec || textures[3] != gEmission || textures[4] != gDepth
+            || pool->GetGeneration() != poolGeneration) {
+            poolGeneration = pool->GetGeneration();
+            gPosition = textures[0];
+            gNormal = textures[1];
+            gAlbedoSpec = textures[2];
+            gEmission = textures[3];
+            gDepth = textures[4];
 
-        unsigned int attachments[4] = {
-            GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3
-        };
-        glDrawBuffers(4, attachments);
+            glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gAlbedoSpec, 0);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, gEmission, 0);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, gDepth, 0);
 
-        // Depth Buffer
-        glGenRenderbuffers(1, &rboDepth);
-        glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
+            unsigned int attachments[4] = {
+                compact ? (unsigned int)GL_NONE : GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3
+            };
+            glDrawBuffers(4, attachments);
 
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            std::cout << "Framebuffer not complete!" << std::endl;
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "Framebuffer not complete!" << std::endl;
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        }
+    }
+
+    // The texture ids stay valid until the pool hands the targets to another pass
+    void Release(RenderTargetPool* pool) {
+        for (int i = 0; i < TARGET_COUNT; i++) pool->Release(targets[i]);
+    }
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // Bytes written / read per pixel by the geometry pass, depth included
+    static int GetBytesPerPixel(GBufferLayout layout) {
+        if (layout == GBufferLayout::Compact) return 4 + 4 + 4 + 4;  // depth, normal, albedo, emission
+        return 8 + 8 + 4 + 4 + 4; // position, normal, albedo, emission (RGB8 is padded to 4 bytes), depth
     }
+
+private:
+    static const int TARGET_COUNT = 5; // position, normal, albedo/spec, emission, depth
+    RenderTarget* targets[TARGET_COUNT];
+    unsigned int poolGeneration; // pool generation of the attached textures
 };
\ No newline at end of file
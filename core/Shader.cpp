@@ -1,6 +1,13 @@
 #include "Shader.h"
+#include <cstring>
+#include <chrono>
+#include <algorithm>
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* tcsPath, const char* tesPath)
+std::vector<Shader*> Shader::instances;
+unsigned int Shader::reloads = 0;
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* tcsPath, const char* tesPath,
+    const std::vector<std::string>& defines)
 {
     // 1. qɮ׸|ŪlX
     std::string vertexCode, fragmentCode, tcsCode, tesCode;
@@ -44,73 +51,455 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* tcs
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
     }
 
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
+    // 2. sĶ Shaders (cache hit: program binary instead)
+    std::vector<Stage> stages(2);
+    stages[0].type = GL_VERTEX_SHADER;
+    stages[0].source = preprocess(vertexCode, vertexPath, defines, stages[0].files);
+    stages[1].type = GL_FRAGMENT_SHADER;
+    stages[1].source = preprocess(fragmentCode, fragmentPath, defines, stages[1].files);
+    if (tcsPath != nullptr && tesPath != nullptr) {
+        stages.resize(4);
+        stages[2].type = GL_TESS_CONTROL_SHADER;
+        stages[2].source = preprocess(tcsCode, tcsPath, defines, stages[2].files);
+        stages[3].type = GL_TESS_EVALUATION_SHADER;
+        stages[3].source = preprocess(tesCode, tesPath, defines, stages[3].files);
+    }
+    this->defines = defines;
+    build(stages);
+}
 
-    // 2. sĶ Shaders
-    unsigned int vertex, fragment, tcs, tes;
+Shader::Shader(const char* computePath, const std::vector<std::string>& defines)
+{
+    std::string computeCode;
+    std::ifstream cShaderFile;
+    cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
 
-    // Vertex Shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    checkCompileErrors(vertex, "VERTEX");
+    try {
+        cShaderFile.open(computePath);
+        std::stringstream cShaderStream;
+        cShaderStream << cShaderFile.rdbuf();
+        cShaderFile.close();
+        computeCode = cShaderStream.str();
+    }
+    catch (std::ifstream::failure& e) {
+        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << computePath << std::endl;
+    }
+
+    std::vector<Stage> stages(1);
+    stages[0].type = GL_COMPUTE_SHADER;
+    stages[0].source = preprocess(computeCode, computePath, defines, stages[0].files);
+    this->defines = defines;
+    build(stages);
+}
 
-    // Fragment Shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
-    checkCompileErrors(fragment, "FRAGMENT");
+static bool readFile(const std::string& path, std::string& code) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::stringstream stream;
+    stream << file.rdbuf();
+    code = stream.str();
+    return true;
+}
 
-    // Tessellation Shaders
-    if (tcsPath != nullptr && tesPath != nullptr) {
-        const char* tcsShaderCode = tcsCode.c_str();
-        const char* tesShaderCode = tesCode.c_str();
+static std::string directoryOf(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+// #include "file", relative to the including file, each file at most once per stage.
+// #line keeps compiler messages usable: source string n is files[n].
+static std::string expandIncludes(const std::string& source, const std::string& path, std::vector<std::string>& files) {
+    int fileIndex = (int)files.size() - 1;
+    std::istringstream lines(source);
+    std::string line, code;
+    int lineNumber = 0;
+    while (std::getline(lines, line)) {
+        lineNumber++;
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+            code += line;
+            code += '\n';
+            continue;
+        }
+
+        size_t open = line.find('"', start);
+        size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+        if (close == std::string::npos) {
+            std::cout << "ERROR::SHADER::BAD_INCLUDE: " << path << ":" << lineNumber << std::endl;
+            continue;
+        }
+        std::string includePath = directoryOf(path) + line.substr(open + 1, close - open - 1);
+        if (std::find(files.begin(), files.end(), includePath) != files.end()) continue;
+
+        std::string includeCode;
+        if (!readFile(includePath, includeCode)) {
+            std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND: " << includePath << " (in " << path << ")" << std::endl;
+            continue;
+        }
+        files.push_back(includePath);
+        code += "#line 1 " + std::to_string(files.size() - 1) + "\n";
+        code += expandIncludes(includeCode, includePath, files);
+        code += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+    }
+    return code;
+}
+
+std::string Shader::preprocess(const std::string& source, const char* path, const std::vector<std::string>& defines,
+    std::vector<std::string>& files) {
+    files.assign(1, path);
+    std::string code = expandIncludes(source, path, files);
+    if (defines.empty()) return code;
+
+    // right after #version, which has to stay the first directive
+    size_t version = code.find("#version");
+    size_t insertAt = version == std::string::npos ? 0 : code.find('\n', version) + 1;
+    int nextLine = (int)std::count(code.begin(), code.begin() + insertAt, '\n') + 1;
+    std::string block;
+    for (const std::string& define : defines) block += "#define " + define + "\n";
+    block += "#line " + std::to_string(nextLine) + " 0\n";
+    code.insert(insertAt, block);
+    return code;
+}
 
-        tcs = glCreateShader(GL_TESS_CONTROL_SHADER);
-        glShaderSource(tcs, 1, &tcsShaderCode, NULL);
-        glCompileShader(tcs);
-        checkCompileErrors(tcs, "TESS_CONTROL");
+static const char* stageName(GLenum type) {
+    switch (type) {
+    case GL_VERTEX_SHADER: return "VERTEX";
+    case GL_FRAGMENT_SHADER: return "FRAGMENT";
+    case GL_TESS_CONTROL_SHADER: return "TESS_CONTROL";
+    case GL_TESS_EVALUATION_SHADER: return "TESS_EVALUATION";
+    default: return "COMPUTE";
+    }
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
 
-        tes = glCreateShader(GL_TESS_EVALUATION_SHADER);
-        glShaderSource(tes, 1, &tesShaderCode, NULL);
-        glCompileShader(tes);
-        checkCompileErrors(tes, "TESS_EVALUATION");
+bool Shader::submit(PendingBuild& build, const std::vector<Stage>& stages) {
+    std::vector<std::string> sources;
+    for (const Stage& stage : stages) sources.push_back(stage.source);
+    build.cacheKey = ShaderCache::Key(sources);
+    if (ShaderCache::Load(build.cacheKey, build.program)) {
+        ShaderCache::stats.hits++;
+        return true;
     }
 
-    // 3. Shader Program
+    ShaderCache::stats.misses++;
+    glProgramParameteri(build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    for (const Stage& stage : stages) {
+        const char* code = stage.source.c_str();
+        unsigned int shader = glCreateShader(stage.type);
+        glShaderSource(shader, 1, &code, NULL);
+        glCompileShader(shader);
+        glAttachShader(build.program, shader);
+        build.shaders.push_back(shader);
+        build.types.push_back(stage.type);
+        build.files.push_back(stage.files);
+    }
+    glLinkProgram(build.program);
+    return false;
+}
+
+bool Shader::finish(PendingBuild& build) {
+    for (size_t i = 0; i < build.shaders.size(); i++) {
+        if (checkCompileErrors(build.shaders[i], stageName(build.types[i]))) continue;
+        for (size_t n = 0; n < build.files[i].size(); n++)
+            std::cout << "  source " << n << ": " << build.files[i][n] << std::endl;
+    }
+    checkCompileErrors(build.program, "PROGRAM");
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(build.program, GL_LINK_STATUS, &linked);
+    for (unsigned int shader : build.shaders) {
+        glDetachShader(build.program, shader);
+        glDeleteShader(shader);
+    }
+    build.shaders.clear();
+    build.types.clear();
+    build.files.clear();
+
+    if (linked) ShaderCache::Store(build.cacheKey, build.program);
+    return linked != GL_FALSE;
+}
+
+void Shader::build(const std::vector<Stage>& stages) {
+    auto start = std::chrono::steady_clock::now();
+    for (const Stage& stage : stages) {
+        sourceTypes.push_back(stage.type);
+        sourcePaths.push_back(stage.files[0]);
+        for (const std::string& file : stage.files)
+            if (!UsesFile(file)) sourceFiles.push_back(file);
+    }
+    reloading = false;
+    instances.push_back(this);
+
+    // cache miss: submit only, compile + link results are checked at first use,
+    // so every miss created before that compiles side by side
     ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
-    if (tcsPath != nullptr) {
-        glAttachShader(ID, tcs);
-        glAttachShader(ID, tes);
+    compile.program = ID;
+    pending = !submit(compile, stages);
+    if (!pending) reflect();
+    ShaderCache::stats.createMs += millisecondsSince(start);
+}
+
+void Shader::finishLink() const {
+    if (!pending) return;
+    pending = false;
+    auto start = std::chrono::steady_clock::now();
+    if (finish(compile)) reflect();
+    ShaderCache::stats.waitMs += millisecondsSince(start);
+
+    // uniforms set while the program was still compiling
+    for (const std::function<void()>& set : deferredSets) set();
+    deferredSets.clear();
+}
+
+Shader::~Shader() {
+    instances.erase(std::find(instances.begin(), instances.end(), this));
+    if (reloading) {
+        finish(reload);
+        glDeleteProgram(reload.program);
     }
-    glLinkProgram(ID);
-    checkCompileErrors(ID, "PROGRAM");
+}
+
+bool Shader::UsesFile(const std::string& path) const {
+    return std::find(sourceFiles.begin(), sourceFiles.end(), path) != sourceFiles.end();
+}
 
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
-    if (tcsPath != nullptr) {
-        glDeleteShader(tcs);
-        glDeleteShader(tes);
+void Shader::Reload() {
+    if (reloading) { // superseded by a newer edit
+        finish(reload);
+        glDeleteProgram(reload.program);
+        reloading = false;
     }
+
+    std::vector<Stage> stages(sourcePaths.size());
+    for (size_t i = 0; i < stages.size(); i++) {
+        std::string code;
+        if (!readFile(sourcePaths[i], code)) {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << sourcePaths[i] << std::endl;
+            return;
+        }
+        stages[i].type = sourceTypes[i];
+        stages[i].source = preprocess(code, sourcePaths[i].c_str(), defines, stages[i].files);
+    }
+
+    reload = PendingBuild();
+    reload.program = glCreateProgram();
+    submit(reload, stages);
+    reload.files.clear();
+    for (const Stage& stage : stages) reload.files.push_back(stage.files); // new include set, kept for the swap
+    reloading = true;
+}
+
+bool Shader::IsReloadReady() const {
+    if (!reloading) return false;
+    if (reload.shaders.empty() || !ShaderCache::parallelCompile) return true; // cache hit / nothing to poll
+    GLint done = GL_FALSE;
+    glGetProgramiv(reload.program, GL_COMPLETION_STATUS_KHR, &done);
+    return done != GL_FALSE;
 }
 
-void Shader::use() { glUseProgram(ID); }
-void Shader::setBool(const std::string& name, bool value) const { glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); }
-void Shader::setInt(const std::string& name, int value) const { glUniform1i(glGetUniformLocation(ID, name.c_str()), value); }
-void Shader::setFloat(const std::string& name, float value) const { glUniform1f(glGetUniformLocation(ID, name.c_str()), value); }
-void Shader::setMat4(const std::string& name, const float* value) const { glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, value); }
-void Shader::setVec3(const std::string& name, const glm::vec3& value) const {
-    glProgramUniform3fv(ID, glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+bool Shader::FinishReload() {
+    if (!reloading) return false;
+    reloading = false;
+    std::vector<std::vector<std::string>> files = reload.files;
+    if (!reload.shaders.empty() && !finish(reload)) {
+        std::cout << "Shader reload failed, keeping the previous program (" << sourcePaths.back() << ")" << std::endl;
+        glDeleteProgram(reload.program);
+        return false;
+    }
+
+    finishLink();
+    copyUniformsTo(reload.program);
+    glDeleteProgram(ID);
+    ID = reload.program;
+    reflect();
+    reloads++;
+
+    sourceFiles.clear();
+    for (const std::vector<std::string>& stageFiles : files)
+        for (const std::string& file : stageFiles)
+            if (!UsesFile(file)) sourceFiles.push_back(file);
+    return true;
 }
-void Shader::setVec2(const std::string& name, const glm::vec2& value) const {
-    glProgramUniform2fv(ID, glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+
+// Values set once (sampler units, constants) survive the swap, per-frame uniforms are set again anyway.
+// Matched by name and type, so renamed / retyped uniforms simply start at 0.
+void Shader::copyUniformsTo(unsigned int program) const {
+    GLint count = 0;
+    glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+    char name[256];
+    const GLenum props[3] = { GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE };
+    for (GLint i = 0; i < count; i++) {
+        GLint values[3];
+        glGetProgramResourceiv(program, GL_UNIFORM, i, 3, props, 3, NULL, values);
+        if (values[0] < 0) continue;
+        glGetProgramResourceName(program, GL_UNIFORM, i, sizeof(name), NULL, name);
+        char* bracket = strchr(name, '[');
+        if (bracket) *bracket = '\0';
+        const UniformSlot* slot = find(uniforms, UniformName(name));
+        GLenum type = (GLenum)values[1];
+        if (slot == nullptr || slot->type != type) continue;
+
+        for (GLint element = 0; element < values[2]; element++) {
+            GLint from = slot->location + element, to = values[0] + element;
+            GLfloat f[16];
+            GLint n[4];
+            GLuint u[4];
+            switch (type) {
+            case GL_FLOAT: glGetUniformfv(ID, from, f); glProgramUniform1fv(program, to, 1, f); break;
+            case GL_FLOAT_VEC2: glGetUniformfv(ID, from, f); glProgramUniform2fv(program, to, 1, f); break;
+            case GL_FLOAT_VEC3: glGetUniformfv(ID, from, f); glProgramUniform3fv(program, to, 1, f); break;
+            case GL_FLOAT_VEC4: glGetUniformfv(ID, from, f); glProgramUniform4fv(program, to, 1, f); break;
+            case GL_FLOAT_MAT3: glGetUniformfv(ID, from, f); glProgramUniformMatrix3fv(program, to, 1, GL_FALSE, f); break;
+            case GL_FLOAT_MAT4: glGetUniformfv(ID, from, f); glProgramUniformMatrix4fv(program, to, 1, GL_FALSE, f); break;
+            case GL_UNSIGNED_INT: glGetUniformuiv(ID, from, u); glProgramUniform1uiv(program, to, 1, u); break;
+            case GL_INT_VEC2: glGetUniformiv(ID, from, n); glProgramUniform2iv(program, to, 1, n); break;
+            case GL_INT_VEC3: glGetUniformiv(ID, from, n); glProgramUniform3iv(program, to, 1, n); break;
+            case GL_INT_VEC4: glGetUniformiv(ID, from, n); glProgramUniform4iv(program, to, 1, n); break;
+            default: glGetUniformiv(ID, from, n); glProgramUniform1iv(program, to, 1, n); break; // int, bool, samplers, images
+            }
+        }
+    }
+}
+
+void Shader::use() {
+    finishLink();
+    glUseProgram(ID);
 }
 
+void Shader::insert(std::vector<UniformSlot>& table, uint32_t hash, GLint location, GLenum type) {
+    size_t mask = table.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        if (table[i].location < 0) {
+            table[i] = { hash, location, type };
+            return;
+        }
+        if (table[i].hash == hash) {
+            std::cout << "Shader: uniform name hash collision (" << hash << ")" << std::endl;
+            return;
+        }
+    }
+}
+
+const Shader::UniformSlot* Shader::find(const std::vector<UniformSlot>& table, uint32_t hash) {
+    if (table.empty()) return nullptr;
+    size_t mask = table.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        if (table[i].location < 0) return nullptr;
+        if (table[i].hash == hash) return &table[i];
+    }
+}
+
+static size_t tableSize(GLint count) {
+    size_t size = 8;
+    while (size < (size_t)count * 2) size *= 2; // load factor <= 0.5, never full
+    return size;
+}
+
+void Shader::reflect() const {
+    // 1. uniforms in the default block (block members have location -1)
+    GLint count = 0;
+    glGetProgramInterfaceiv(ID, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+    uniforms.assign(tableSize(count), UniformSlot{ 0, -1, GL_NONE });
+
+    char name[256];
+    const GLenum props[2] = { GL_LOCATION, GL_TYPE };
+    for (GLint i = 0; i < count; i++) {
+        GLint values[2];
+        glGetProgramResourceiv(ID, GL_UNIFORM, i, 2, props, 2, NULL, values);
+        if (values[0] < 0) continue;
+        glGetProgramResourceName(ID, GL_UNIFORM, i, sizeof(name), NULL, name);
+        // arrays are reported as "name[0]"
+        char* bracket = strchr(name, '[');
+        if (bracket) *bracket = '\0';
+        insert(uniforms, UniformName(name), values[0], (GLenum)values[1]);
+    }
+
+    // 2. uniform + shader storage blocks, by binding
+    GLint uniformBlocks = 0, storageBlocks = 0;
+    glGetProgramInterfaceiv(ID, GL_UNIFORM_BLOCK, GL_ACTIVE_RESOURCES, &uniformBlocks);
+    glGetProgramInterfaceiv(ID, GL_SHADER_STORAGE_BLOCK, GL_ACTIVE_RESOURCES, &storageBlocks);
+    blocks.assign(tableSize(uniformBlocks + storageBlocks), UniformSlot{ 0, -1, GL_NONE });
+
+    const GLenum interfaces[2] = { GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK };
+    const GLint blockCounts[2] = { uniformBlocks, storageBlocks };
+    const GLenum bindingProp = GL_BUFFER_BINDING;
+    for (int k = 0; k < 2; k++) {
+        for (GLint i = 0; i < blockCounts[k]; i++) {
+            GLint binding;
+            glGetProgramResourceiv(ID, interfaces[k], i, 1, &bindingProp, 1, NULL, &binding);
+            glGetProgramResourceName(ID, interfaces[k], i, sizeof(name), NULL, name);
+            insert(blocks, UniformName(name), binding, interfaces[k]);
+        }
+    }
+}
+
+const Shader::UniformSlot* Shader::findUniform(uint32_t hash) const {
+    finishLink();
+    return find(uniforms, hash);
+}
+
+int Shader::GetBlockBinding(uint32_t nameHash) const {
+    finishLink();
+    const UniformSlot* slot = find(blocks, nameHash);
+    return slot ? slot->location : -1;
+}
+
+// ints set samplers / images too
+bool Shader::typeMatches(GLenum type, GLenum requested) {
+    if (type == requested) return true;
+    if (requested == GL_INT) {
+        switch (type) {
+        case GL_SAMPLER_2D: case GL_SAMPLER_3D: case GL_SAMPLER_CUBE: case GL_SAMPLER_2D_SHADOW:
+        case GL_IMAGE_2D: case GL_IMAGE_3D: case GL_BOOL:
+            return true;
+        }
+    }
+    return requested == GL_BOOL && type == GL_INT;
+}
+
+// by name: same table, a missing uniform is silently ignored (as glUniform* with location -1).
+// While the program is still compiling the value is kept and applied by finishLink().
+template <typename Fn>
+void Shader::setUniform(const char* name, Fn set) const {
+    uint32_t hash = UniformName(name);
+    if (pending) {
+        deferredSets.push_back([this, hash, set]() {
+            if (const UniformSlot* slot = find(uniforms, hash)) set(slot->location);
+        });
+        return;
+    }
+    if (const UniformSlot* slot = find(uniforms, hash)) set(slot->location);
+}
+
+void Shader::setBool(const char* name, bool value) const {
+    setUniform(name, [this, value](GLint location) { glProgramUniform1i(ID, location, (int)value); });
+}
+void Shader::setInt(const char* name, int value) const {
+    setUniform(name, [this, value](GLint location) { glProgramUniform1i(ID, location, value); });
+}
+void Shader::setFloat(const char* name, float value) const {
+    setUniform(name, [this, value](GLint location) { glProgramUniform1f(ID, location, value); });
+}
+void Shader::setMat4(const char* name, const float* value) const {
+    glm::mat4 matrix;
+    memcpy(&matrix[0][0], value, sizeof(matrix));
+    setUniform(name, [this, matrix](GLint location) { glProgramUniformMatrix4fv(ID, location, 1, GL_FALSE, &matrix[0][0]); });
+}
+void Shader::setVec3(const char* name, const glm::vec3& value) const {
+    setUniform(name, [this, value](GLint location) { glProgramUniform3fv(ID, location, 1, &value[0]); });
+}
+void Shader::setVec2(const char* name, const glm::vec2& value) const {
+    setUniform(name, [this, value](GLint location) { glProgramUniform2fv(ID, location, 1, &value[0]); });
+}
+void Shader::setVec4Array(const char* name, const glm::vec4* values, int count) const {
+    finishLink(); // the array is not copied
+    setUniform(name, [this, values, count](GLint location) { glProgramUniform4fv(ID, location, count, &values[0][0]); });
+}
 
-void Shader::checkCompileErrors(unsigned int shader, std::string type)
+bool Shader::checkCompileErrors(unsigned int shader, std::string type)
 {
     int success;
     char infoLog[1024];
@@ -128,4 +517,5 @@ void Shader::checkCompileErrors(unsigned int shader, std::string type)
             std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
         }
     }
+    return success != 0;
 }
\ No newline at end of file
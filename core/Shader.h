@@ -5,24 +5,165 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <cstdint>
+#include <functional>
 #include <glm/glm.hpp>
+#include "ShaderCache.h"
+
+// FNV-1a of a uniform / block name. constexpr, so literal names hash at compile time:
+//   static const uint32_t VIEW = UniformName("view");
+constexpr uint32_t UniformName(const char* name, uint32_t hash = 2166136261u) {
+    return *name ? UniformName(name + 1, (hash ^ (uint32_t)(unsigned char)*name) * 16777619u) : hash;
+}
+
+// Typed uniform of one program: location resolved once, Set() is a single DSA call
+// (no lookup, no allocation, works whether or not the program is bound)
+template <typename T>
+struct UniformHandle {
+    GLuint program;
+    GLint location; // -1: not active in the program, Set() is a no-op like glUniform*
+
+    UniformHandle() : program(0), location(-1) {}
+    UniformHandle(GLuint program, GLint location) : program(program), location(location) {}
+
+    bool IsValid() const { return location >= 0; }
+    void Set(const T& value) const { Set(&value, 1); }
+    void Set(const T* values, int count) const;
+};
+
+template <> inline void UniformHandle<bool>::Set(const bool* values, int count) const {
+    for (int i = 0; i < count; i++) glProgramUniform1i(program, location + i, (int)values[i]);
+}
+template <> inline void UniformHandle<int>::Set(const int* values, int count) const { glProgramUniform1iv(program, location, count, values); }
+template <> inline void UniformHandle<unsigned int>::Set(const unsigned int* values, int count) const { glProgramUniform1uiv(program, location, count, values); }
+template <> inline void UniformHandle<float>::Set(const float* values, int count) const { glProgramUniform1fv(program, location, count, values); }
+template <> inline void UniformHandle<glm::vec2>::Set(const glm::vec2* values, int count) const { glProgramUniform2fv(program, location, count, &values[0].x); }
+template <> inline void UniformHandle<glm::vec3>::Set(const glm::vec3* values, int count) const { glProgramUniform3fv(program, location, count, &values[0].x); }
+template <> inline void UniformHandle<glm::vec4>::Set(const glm::vec4* values, int count) const { glProgramUniform4fv(program, location, count, &values[0].x); }
+template <> inline void UniformHandle<glm::mat4>::Set(const glm::mat4* values, int count) const {
+    glProgramUniformMatrix4fv(program, location, count, GL_FALSE, &values[0][0].x);
+}
 
 class Shader
 {
 public:
     unsigned int ID;
 
-    Shader(const char* vertexPath, const char* fragmentPath, const char* tcsPath = nullptr, const char* tesPath = nullptr);
+    // Sources go through preprocess(): #include "file" is resolved, defines ("NAME" / "NAME VALUE") are injected
+    Shader(const char* vertexPath, const char* fragmentPath, const char* tcsPath = nullptr, const char* tesPath = nullptr,
+        const std::vector<std::string>& defines = std::vector<std::string>());
+    Shader(const char* computePath, const std::vector<std::string>& defines = std::vector<std::string>()); // compute program
+    ~Shader();
 
+    // Every constructed Shader (hot reload looks up the programs using a changed file)
+    static const std::vector<Shader*>& GetInstances() { return instances; }
+    // Bumped whenever a reload swaps in a new program: UniformHandles of the old one are stale
+    static unsigned int reloads;
+
+    // Waits for the compile / link on first use (cache misses are only submitted by the constructor)
     void use();
 
-    void setBool(const std::string& name, bool value) const;
-    void setInt(const std::string& name, int value) const;
-    void setFloat(const std::string& name, float value) const;
-    void setMat4(const std::string& name, const float* value) const;
-    void setVec3(const std::string& name, const glm::vec3& value) const;
-	void setVec2(const std::string& name, const glm::vec2& value) const;
+    // Handle of an active uniform (arrays: name without "[0]"), invalid if inactive, + warning if the type differs
+    template <typename T>
+    UniformHandle<T> GetUniform(uint32_t nameHash) const;
+    // Binding of an active uniform / shader storage block, -1 if missing
+    int GetBlockBinding(uint32_t nameHash) const;
+
+    // By name: hashed at run time + table lookup, no glGetUniformLocation, no allocation for literals
+    void setBool(const char* name, bool value) const;
+    void setInt(const char* name, int value) const;
+    void setFloat(const char* name, float value) const;
+    void setMat4(const char* name, const float* value) const;
+    void setVec3(const char* name, const glm::vec3& value) const;
+    void setVec2(const char* name, const glm::vec2& value) const;
+    void setVec4Array(const char* name, const glm::vec4* values, int count) const;
+    void setBool(const std::string& name, bool value) const { setBool(name.c_str(), value); }
+    void setInt(const std::string& name, int value) const { setInt(name.c_str(), value); }
+    void setFloat(const std::string& name, float value) const { setFloat(name.c_str(), value); }
+
+    // Hot reload: Reload() re-reads + preprocesses the sources and submits a new build next to the
+    // current program; once IsReloadReady(), FinishReload() swaps it in (uniform values carried over)
+    // or, if it failed to compile / link, drops it and keeps the current program.
+    const std::vector<std::string>& GetSourceFiles() const { return sourceFiles; } // stages + includes
+    bool UsesFile(const std::string& path) const;
+    void Reload();
+    bool IsReloadReady() const;
+    bool FinishReload(); // true: swapped
 
 private:
-    void checkCompileErrors(unsigned int shader, std::string type);
-};
\ No newline at end of file
+    // Flat open addressing table (power of two), filled by reflect() after link
+    struct UniformSlot {
+        uint32_t hash;
+        GLint location; // -1: empty slot
+        GLenum type;
+    };
+    mutable std::vector<UniformSlot> uniforms;
+    mutable std::vector<UniformSlot> blocks; // location holds the buffer binding
+
+    struct Stage {
+        GLenum type;
+        std::string source;             // preprocessed
+        std::vector<std::string> files; // #line source string -> file, for error messages
+    };
+    // compile + link submitted to `program`, results not checked yet
+    struct PendingBuild {
+        unsigned int program;
+        uint64_t cacheKey;
+        std::vector<unsigned int> shaders; // empty: linked from the cache
+        std::vector<GLenum> types;
+        std::vector<std::vector<std::string>> files;
+    };
+    mutable bool pending; // first build of ID
+    mutable PendingBuild compile;
+    mutable std::vector<std::function<void()>> deferredSets;
+
+    // what Reload() rebuilds from
+    std::vector<GLenum> sourceTypes;
+    std::vector<std::string> sourcePaths;
+    std::vector<std::string> defines;
+    std::vector<std::string> sourceFiles;
+    bool reloading;
+    PendingBuild reload;
+
+    static std::vector<Shader*> instances;
+
+    static std::string preprocess(const std::string& source, const char* path, const std::vector<std::string>& defines,
+        std::vector<std::string>& files);
+    static bool submit(PendingBuild& build, const std::vector<Stage>& stages); // true: cache hit, already linked
+    static bool finish(PendingBuild& build); // true: linked
+    void build(const std::vector<Stage>& stages);
+    void finishLink() const;
+    void copyUniformsTo(unsigned int program) const;
+    template <typename Fn> void setUniform(const char* name, Fn set) const;
+
+    void reflect() const;
+    const UniformSlot* findUniform(uint32_t hash) const;
+    static const UniformSlot* find(const std::vector<UniformSlot>& table, uint32_t hash);
+    static void insert(std::vector<UniformSlot>& table, uint32_t hash, GLint location, GLenum type);
+    static bool typeMatches(GLenum type, GLenum requested);
+
+    template <typename T> static GLenum glTypeOf();
+
+    static bool checkCompileErrors(unsigned int shader, std::string type); // false: error printed
+};
+
+template <> inline GLenum Shader::glTypeOf<bool>() { return GL_BOOL; }
+template <> inline GLenum Shader::glTypeOf<int>() { return GL_INT; }
+template <> inline GLenum Shader::glTypeOf<unsigned int>() { return GL_UNSIGNED_INT; }
+template <> inline GLenum Shader::glTypeOf<float>() { return GL_FLOAT; }
+template <> inline GLenum Shader::glTypeOf<glm::vec2>() { return GL_FLOAT_VEC2; }
+template <> inline GLenum Shader::glTypeOf<glm::vec3>() { return GL_FLOAT_VEC3; }
+template <> inline GLenum Shader::glTypeOf<glm::vec4>() { return GL_FLOAT_VEC4; }
+template <> inline GLenum Shader::glTypeOf<glm::mat4>() { return GL_FLOAT_MAT4; }
+
+template <typename T>
+UniformHandle<T> Shader::GetUniform(uint32_t nameHash) const {
+    const UniformSlot* slot = findUniform(nameHash);
+    if (slot == nullptr) return UniformHandle<T>(ID, -1);
+    if (!typeMatches(slot->type, glTypeOf<T>())) {
+        std::cout << "Shader " << ID << ": uniform type mismatch (hash " << nameHash << ")" << std::endl;
+        return UniformHandle<T>(ID, -1);
+    }
+    return UniformHandle<T>(ID, slot->location);
+}
\ No newline at end of file
@@ -0,0 +1,219 @@
+#include "ShaderCache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+bool ShaderCache::enabled = true;
+bool ShaderCache::parallelCompile = false;
+ShaderCacheStats ShaderCache::stats = { 0, 0, 0.0, 0.0 };
+std::map<uint64_t, ShaderCache::Entry> ShaderCache::entries;
+std::string ShaderCache::path;
+std::string ShaderCache::driver;
+uint32_t ShaderCache::session = 0;
+
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+// header: magic, version, driver hash (8), session
+// record: key (8), last session (4), format (4), size (4), binary
+static const uint32_t CACHE_MAGIC = 0x43485343; // "CSHC"
+static const uint32_t CACHE_VERSION = 2;
+static const std::streamoff SESSION_OFFSET = 4 + 4 + 8;
+static const std::streamoff RECORD_HEADER_SIZE = 8 + 4 + 4 + 4;
+
+static std::fstream cacheFile; // open for the whole run: binaries are read on a hit, new ones appended
+
+static uint64_t fnv1a64(const char* data, size_t size, uint64_t hash) {
+    for (size_t i = 0; i < size; i++) hash = (hash ^ (unsigned char)data[i]) * 1099511628211ull;
+    return hash;
+}
+
+template <typename T> static bool readValue(std::istream& in, T& value) { return (bool)in.read((char*)&value, sizeof(T)); }
+template <typename T> static void writeValue(std::ostream& out, const T& value) { out.write((const char*)&value, sizeof(T)); }
+
+void ShaderCache::Init(GLADloadproc loadProc, const char* cachePath) {
+    path = cachePath;
+    driver = std::string((const char*)glGetString(GL_VENDOR)) + "|" + (const char*)glGetString(GL_RENDERER) + "|" + (const char*)glGetString(GL_VERSION);
+
+    // 1. parallel compile: let the driver use as many threads as it likes
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount; i++) {
+        const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (strcmp(name, "GL_KHR_parallel_shader_compile") == 0 || strcmp(name, "GL_ARB_parallel_shader_compile") == 0) {
+            PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loadProc("glMaxShaderCompilerThreadsKHR");
+            if (maxThreads == nullptr) maxThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loadProc("glMaxShaderCompilerThreadsARB");
+            if (maxThreads) {
+                maxThreads(0xFFFFFFFFu);
+                parallelCompile = true;
+            }
+            break;
+        }
+    }
+
+    // 2. binaries (the driver may not support any binary format)
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats == 0) enabled = false;
+    if (!enabled) return;
+
+    uint64_t driverHash = fnv1a64(driver.data(), driver.size(), 14695981039346656037ull);
+    bool rewrite = true; // missing / foreign file: start a new one
+    uint32_t previousSession = 0;
+    {
+        std::ifstream file(path, std::ios::binary);
+        uint32_t magic = 0, version = 0;
+        uint64_t fileDriver = 0;
+        if (readValue(file, magic) && readValue(file, version) && readValue(file, fileDriver) && readValue(file, previousSession)
+            && magic == CACHE_MAGIC && version == CACHE_VERSION && fileDriver == driverHash) {
+            rewrite = false;
+            // index only, skip over the binaries
+            uint64_t key;
+            Entry entry;
+            while (readValue(file, key) && readValue(file, entry.lastSession) && readValue(file, entry.format) && readValue(file, entry.size)) {
+                entry.offset = (uint64_t)file.tellg();
+                if (!file.seekg(entry.size, std::ios::cur)) break;
+                if (entries.count(key)) rewrite = true; // the last record of a key wins
+                entries[key] = entry;
+            }
+            // truncated tail (crash while appending): the last record may be cut short
+            file.clear();
+            file.seekg(0, std::ios::end);
+            uint64_t fileSize = (uint64_t)file.tellg();
+            for (auto it = entries.begin(); it != entries.end();) {
+                if (it->second.offset + it->second.size > fileSize) { it = entries.erase(it); rewrite = true; }
+                else ++it;
+            }
+        }
+        else {
+            previousSession = 0;
+        }
+    }
+
+    session = previousSession + 1;
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (session - it->second.lastSession > MAX_IDLE_SESSIONS) { it = entries.erase(it); rewrite = true; }
+        else ++it;
+    }
+    if (rewrite) compact();
+
+    cacheFile.open(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!cacheFile) {
+        std::cout << "ShaderCache: cannot open " << path << ", cache off" << std::endl;
+        entries.clear();
+        enabled = false;
+        return;
+    }
+    if (!rewrite) {
+        cacheFile.seekp(SESSION_OFFSET);
+        writeValue(cacheFile, session);
+        cacheFile.flush();
+    }
+}
+
+void ShaderCache::compact() {
+    std::string tempPath = path + ".tmp";
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) return;
+        uint64_t driverHash = fnv1a64(driver.data(), driver.size(), 14695981039346656037ull);
+        writeValue(out, CACHE_MAGIC);
+        writeValue(out, CACHE_VERSION);
+        writeValue(out, driverHash);
+        writeValue(out, session);
+
+        std::vector<char> binary;
+        for (auto it = entries.begin(); it != entries.end();) {
+            Entry& entry = it->second;
+            binary.resize(entry.size);
+            in.clear();
+            if (!in.seekg((std::streamoff)entry.offset) || !in.read(binary.data(), entry.size)) {
+                it = entries.erase(it);
+                continue;
+            }
+            writeValue(out, it->first);
+            writeValue(out, entry.lastSession);
+            writeValue(out, entry.format);
+            writeValue(out, entry.size);
+            entry.offset = (uint64_t)out.tellp();
+            out.write(binary.data(), entry.size);
+            ++it;
+        }
+    }
+    std::remove(path.c_str()); // rename does not overwrite on Windows
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) entries.clear();
+}
+
+uint64_t ShaderCache::Key(const std::vector<std::string>& sources) {
+    uint64_t hash = fnv1a64(driver.data(), driver.size(), 14695981039346656037ull);
+    for (const std::string& source : sources) {
+        hash = fnv1a64(source.data(), source.size(), hash);
+        hash = fnv1a64("\0", 1, hash); // stage separator
+    }
+    return hash;
+}
+
+bool ShaderCache::Load(uint64_t key, unsigned int program) {
+    if (!enabled) return false;
+    auto it = entries.find(key);
+    if (it == entries.end()) return false;
+    Entry& entry = it->second;
+
+    std::vector<char> binary(entry.size);
+    cacheFile.clear();
+    if (!cacheFile.seekg((std::streamoff)entry.offset) || !cacheFile.read(binary.data(), entry.size)) {
+        entries.erase(it);
+        return false;
+    }
+
+    glProgramBinary(program, entry.format, binary.data(), (GLsizei)binary.size());
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        // rejected blob: compile from source, Store() appends the new binary and the next Init() drops this one
+        entries.erase(it);
+        return false;
+    }
+
+    // still in use: keep it through the next compactions
+    if (entry.lastSession != session) {
+        entry.lastSession = session;
+        cacheFile.seekp((std::streamoff)entry.offset - RECORD_HEADER_SIZE + 8);
+        writeValue(cacheFile, session);
+        cacheFile.flush();
+    }
+    return true;
+}
+
+void ShaderCache::Store(uint64_t key, unsigned int program) {
+    if (!enabled) return;
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    Entry entry;
+    std::vector<char> binary(length);
+    glGetProgramBinary(program, length, NULL, &entry.format, binary.data());
+    entry.size = (uint32_t)length;
+    entry.lastSession = session;
+
+    cacheFile.clear();
+    cacheFile.seekp(0, std::ios::end);
+    writeValue(cacheFile, key);
+    writeValue(cacheFile, entry.lastSession);
+    writeValue(cacheFile, entry.format);
+    writeValue(cacheFile, entry.size);
+    entry.offset = (uint64_t)cacheFile.tellp();
+    cacheFile.write(binary.data(), length);
+    cacheFile.flush();
+    if (!cacheFile) return;
+
+    entries[key] = entry;
+}
+
+void ShaderCache::PrintStats(double startupMs) {
+    std::cout << "Startup " << startupMs << " ms | shaders: " << stats.hits << " cached, " << stats.misses << " compiled"
+              << (parallelCompile ? " (parallel)" : "") << ", create " << stats.createMs << " ms, wait " << stats.waitMs << " ms"
+              << (enabled ? "" : " | cache off") << std::endl;
+}
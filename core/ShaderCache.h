@@ -0,0 +1,55 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+
+// GL_KHR_parallel_shader_compile (not in our glad build)
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+struct ShaderCacheStats {
+    int hits, misses;
+    double createMs; // CPU time in Shader constructors (read, hash, submit / load binary)
+    double waitMs;   // time blocked on compile + link results at first use
+};
+
+// Program binaries on disk, keyed by a hash of the driver string + every stage's source
+// (defines included, they are part of the source). One file: new binaries are appended,
+// Init() only indexes the records (binaries are read on a hit) and compacts the file when it
+// holds duplicate keys, another driver's binaries or records unused for MAX_IDLE_SESSIONS runs
+// (old sources, hot reload edits).
+class ShaderCache {
+public:
+    static const uint32_t MAX_IDLE_SESSIONS = 8;
+
+    static bool enabled; // --no-shader-cache: always compile (cold start numbers)
+    static bool parallelCompile; // GL_KHR_parallel_shader_compile available
+    static ShaderCacheStats stats;
+
+    // After the GL context exists: reads the cache file, enables parallel compilation
+    static void Init(GLADloadproc loadProc, const char* path = "shader_cache.bin");
+
+    static uint64_t Key(const std::vector<std::string>& sources);
+    // true: program linked from the cached binary
+    static bool Load(uint64_t key, unsigned int program);
+    static void Store(uint64_t key, unsigned int program);
+
+    static void PrintStats(double startupMs);
+
+private:
+    struct Entry {
+        uint64_t offset; // of the binary in the file
+        uint32_t format, size;
+        uint32_t lastSession; // last run that loaded or stored it
+    };
+    static std::map<uint64_t, Entry> entries;
+    static std::string path;
+    static std::string driver;
+    static uint32_t session; // runs since the file was created
+
+    static void compact(); // rewrites the file with the indexed entries only
+};
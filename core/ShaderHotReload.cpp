@@ -0,0 +1,137 @@
+#include "ShaderHotReload.h"
+#include <chrono>
+#include <iostream>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+ShaderHotReload::ShaderHotReload() : running(true), knownShaders(0), filesDirty(true), inotifyFd(-1) {
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    watcher = std::thread(&ShaderHotReload::watch, this);
+}
+
+ShaderHotReload::~ShaderHotReload() {
+    running = false;
+    watcher.join();
+#ifdef __linux__
+    if (inotifyFd >= 0) close(inotifyFd);
+#endif
+}
+
+void ShaderHotReload::Update() {
+    const std::vector<Shader*>& shaders = Shader::GetInstances();
+
+    // 1. watch the files of new programs (variants are created lazily) and of rebuilt ones (#includes may differ)
+    if (filesDirty || shaders.size() != knownShaders) {
+        std::lock_guard<std::mutex> lock(mutex);
+        watchedFiles.clear();
+        for (Shader* shader : shaders)
+            watchedFiles.insert(shader->GetSourceFiles().begin(), shader->GetSourceFiles().end());
+        knownShaders = shaders.size();
+        filesDirty = false;
+    }
+
+    // 2. rebuild every program using a changed file
+    std::set<std::string> changed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        changed.swap(changedFiles);
+    }
+    for (const std::string& file : changed) {
+        int count = 0;
+        for (Shader* shader : shaders) {
+            if (!shader->UsesFile(file)) continue;
+            shader->Reload();
+            count++;
+        }
+        std::cout << "Shader changed: " << file << ", rebuilding " << count << " program(s)" << std::endl;
+    }
+
+    // 3. swap in finished builds, between two frames
+    for (Shader* shader : shaders) {
+        if (!shader->IsReloadReady()) continue;
+        shader->FinishReload();
+        filesDirty = true;
+    }
+}
+
+void ShaderHotReload::watch() {
+    if (inotifyFd >= 0) {
+        watchInotify();
+        return;
+    }
+    std::map<std::string, std::pair<long long, long long>> stamps;
+    while (running) {
+        pollFiles(stamps);
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    }
+}
+
+// mtime + size, a change of either counts as an edit (mtime alone can be 1 s coarse)
+void ShaderHotReload::pollFiles(std::map<std::string, std::pair<long long, long long>>& stamps) {
+    std::set<std::string> files;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        files = watchedFiles;
+    }
+    for (const std::string& file : files) {
+        struct stat info;
+        if (stat(file.c_str(), &info) != 0) continue; // mid-save (delete + rename), next poll sees it
+        std::pair<long long, long long> stamp((long long)info.st_mtime, (long long)info.st_size);
+        auto found = stamps.find(file);
+        if (found == stamps.end()) {
+            stamps[file] = stamp;
+            continue;
+        }
+        if (found->second == stamp) continue;
+        found->second = stamp;
+        std::lock_guard<std::mutex> lock(mutex);
+        changedFiles.insert(file);
+    }
+}
+
+void ShaderHotReload::watchInotify() {
+#ifdef __linux__
+    std::map<std::string, int> directories; // directory (with trailing '/') -> watch
+    std::map<int, std::string> watches;
+    alignas(inotify_event) char buffer[4096];
+    while (running) {
+        // 1. one watch per directory holding a watched file; editors that save through a temp file + rename
+        //    show up as IN_MOVED_TO, in-place writes as IN_CLOSE_WRITE
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const std::string& file : watchedFiles) {
+                size_t slash = file.find_last_of('/');
+                std::string directory = slash == std::string::npos ? std::string() : file.substr(0, slash + 1);
+                if (directories.count(directory)) continue;
+                int wd = inotify_add_watch(inotifyFd, directory.empty() ? "." : directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+                directories[directory] = wd;
+                if (wd >= 0) watches[wd] = directory;
+            }
+        }
+
+        // 2. wait for events, waking up regularly to notice new directories / shutdown
+        pollfd descriptor = { inotifyFd, POLLIN, 0 };
+        if (poll(&descriptor, 1, 250) <= 0) continue;
+        ssize_t length;
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+            for (ssize_t offset = 0; offset < length;) {
+                const inotify_event* event = (const inotify_event*)(buffer + offset);
+                offset += sizeof(inotify_event) + event->len;
+                if (event->len == 0) continue;
+                auto watch = watches.find(event->wd);
+                if (watch == watches.end()) continue;
+
+                std::string file = watch->second + event->name;
+                std::lock_guard<std::mutex> lock(mutex);
+                if (watchedFiles.count(file)) changedFiles.insert(file);
+            }
+        }
+    }
+#endif
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Shader.h"
+
+// Rebuilds programs whose source files change on disk (stages + #includes of every live Shader).
+// A background thread watches the files: inotify on Linux, file time polling elsewhere.
+// Update() runs on the GL thread at a frame boundary; it only submits the new builds and swaps in
+// the ones that have finished compiling, so a rebuild never stalls a frame on the compiler
+// (with GL_KHR_parallel_shader_compile). A build that fails keeps the previous program.
+class ShaderHotReload {
+public:
+    ShaderHotReload();
+    ~ShaderHotReload();
+
+    void Update();
+
+private:
+    std::thread watcher;
+    std::atomic<bool> running;
+    std::mutex mutex;
+    std::set<std::string> watchedFiles; // mutex, refreshed by Update() when programs come and go
+    std::set<std::string> changedFiles; // mutex, filled by the watcher
+    size_t knownShaders;
+    bool filesDirty;
+    int inotifyFd; // -1: polling
+
+    void watch();
+    void watchInotify();
+    void pollFiles(std::map<std::string, std::pair<long long, long long>>& stamps);
+};
@@ -0,0 +1,30 @@
+#include "ShaderVariants.h"
+
+ShaderVariants::ShaderVariants(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& options,
+    std::function<void(Shader&)> setup)
+    : vertexPath(vertexPath), fragmentPath(fragmentPath), options(options), setup(setup) {
+}
+
+ShaderVariants::ShaderVariants(const char* computePath, const std::vector<std::string>& options, std::function<void(Shader&)> setup)
+    : computePath(computePath), options(options), setup(setup) {
+}
+
+ShaderVariants::~ShaderVariants() {
+    for (auto& variant : variants) delete variant.second;
+}
+
+Shader* ShaderVariants::Get(uint32_t key) {
+    auto found = variants.find(key);
+    if (found != variants.end()) return found->second;
+
+    std::vector<std::string> defines;
+    for (size_t i = 0; i < options.size(); i++)
+        if (key & (1u << i)) defines.push_back(options[i]);
+
+    Shader* shader = computePath.empty()
+        ? new Shader(vertexPath.c_str(), fragmentPath.c_str(), nullptr, nullptr, defines)
+        : new Shader(computePath.c_str(), defines);
+    if (setup) setup(*shader);
+    variants[key] = shader;
+    return shader;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Shader.h"
+
+// Permutations of one program keyed by a bitmask: bit i adds options[i] as a #define
+// ("COMPACT_GBUFFER", "KERNEL_SIZE 16"). A variant is compiled the first time it is asked for
+// and kept, so switching back to it costs nothing; branches on the options compile out.
+class ShaderVariants {
+public:
+    ShaderVariants(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& options,
+        std::function<void(Shader&)> setup = nullptr); // setup: sampler units etc., once per variant
+    ShaderVariants(const char* computePath, const std::vector<std::string>& options,
+        std::function<void(Shader&)> setup = nullptr);
+    ~ShaderVariants();
+
+    Shader* Get(uint32_t key);
+    size_t GetVariantCount() const { return variants.size(); }
+
+private:
+    std::string vertexPath, fragmentPath, computePath;
+    std::vector<std::string> options;
+    std::function<void(Shader&)> setup;
+    std::unordered_map<uint32_t, Shader*> variants;
+};
@@ -0,0 +1,79 @@
+#pragma once
+// Small SSE2 / AVX2 helpers for the SoA systems.
+// SSE2 is always on for x64 builds, the 8-wide path needs /arch:AVX2 (-mavx2).
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_HAS_AVX2 1
+#endif
+
+namespace simd {
+
+// sin/cos over [-pi/4, pi/4] (Cephes single precision coefficients)
+const float SIN_C0 = -1.6666654611e-1f, SIN_C1 = 8.3321608736e-3f, SIN_C2 = -1.9515295891e-4f;
+const float COS_C0 = 4.166664568298827e-2f, COS_C1 = -1.388731625493765e-3f, COS_C2 = 2.443315711809948e-5f;
+// pi/2 split in two for the Cody-Waite reduction
+const float PIO2_HI = 1.5707963705062866f, PIO2_LO = -4.371139000186243e-8f;
+const float TWO_OVER_PI = 0.63661977236758134f;
+
+// 4-wide sincos, accurate to a few ulp for |x| < ~1e4 (callers keep phases wrapped)
+inline void sincos4(__m128 x, __m128& s, __m128& c) {
+    // quadrant q = round(x * 2/pi), r = x - q * pi/2
+    __m128i q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(TWO_OVER_PI)));
+    __m128 qf = _mm_cvtepi32_ps(q);
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(PIO2_HI)));
+    r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(PIO2_LO)));
+    __m128 r2 = _mm_mul_ps(r, r);
+
+    __m128 ps = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(SIN_C2)), _mm_set1_ps(SIN_C1));
+    ps = _mm_add_ps(_mm_mul_ps(ps, r2), _mm_set1_ps(SIN_C0));
+    ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, r2), r), r);
+
+    __m128 pc = _mm_add_ps(_mm_mul_ps(r2, _mm_set1_ps(COS_C2)), _mm_set1_ps(COS_C1));
+    pc = _mm_add_ps(_mm_mul_ps(pc, r2), _mm_set1_ps(COS_C0));
+    pc = _mm_mul_ps(_mm_mul_ps(pc, r2), r2);
+    pc = _mm_add_ps(_mm_sub_ps(pc, _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+    // odd quadrants swap sin/cos, then fix the signs
+    __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+    __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, two), 30));
+    __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, one), two), 30));
+
+    s = _mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps));
+    c = _mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc));
+    s = _mm_xor_ps(s, sinSign);
+    c = _mm_xor_ps(c, cosSign);
+}
+
+#if defined(SIMD_HAS_AVX2)
+// 8-wide version of sincos4
+inline void sincos8(__m256 x, __m256& s, __m256& c) {
+    __m256i q = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(TWO_OVER_PI)));
+    __m256 qf = _mm256_cvtepi32_ps(q);
+    __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(qf, _mm256_set1_ps(PIO2_HI)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(qf, _mm256_set1_ps(PIO2_LO)));
+    __m256 r2 = _mm256_mul_ps(r, r);
+
+    __m256 ps = _mm256_add_ps(_mm256_mul_ps(r2, _mm256_set1_ps(SIN_C2)), _mm256_set1_ps(SIN_C1));
+    ps = _mm256_add_ps(_mm256_mul_ps(ps, r2), _mm256_set1_ps(SIN_C0));
+    ps = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(ps, r2), r), r);
+
+    __m256 pc = _mm256_add_ps(_mm256_mul_ps(r2, _mm256_set1_ps(COS_C2)), _mm256_set1_ps(COS_C1));
+    pc = _mm256_add_ps(_mm256_mul_ps(pc, r2), _mm256_set1_ps(COS_C0));
+    pc = _mm256_mul_ps(_mm256_mul_ps(pc, r2), r2);
+    pc = _mm256_add_ps(_mm256_sub_ps(pc, _mm256_mul_ps(r2, _mm256_set1_ps(0.5f))), _mm256_set1_ps(1.0f));
+
+    __m256i one = _mm256_set1_epi32(1), two = _mm256_set1_epi32(2);
+    __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(q, one), one));
+    __m256 sinSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(q, two), 30));
+    __m256 cosSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(q, one), two), 30));
+
+    s = _mm256_blendv_ps(ps, pc, swap);
+    c = _mm256_blendv_ps(pc, ps, swap);
+    s = _mm256_xor_ps(s, sinSign);
+    c = _mm256_xor_ps(c, cosSign);
+}
+#endif
+
+} // namespace simd
@@ -0,0 +1,35 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads shared by the CPU-side systems
+// (light animation, culling, streaming, ...)
+class ThreadPool {
+public:
+    ThreadPool(unsigned int threadCount = 0); // 0: hardware threads - 1
+    ~ThreadPool();
+
+    unsigned int GetThreadCount() const { return (unsigned int)workers.size(); }
+
+    // Fire-and-forget job
+    void Submit(std::function<void()> job);
+
+    // Split [0, count) into chunks of `grain` and run fn(begin, end) on the workers.
+    // The calling thread helps and returns once every chunk is done.
+    void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn);
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping;
+
+    void workerLoop();
+};
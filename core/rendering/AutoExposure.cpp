@@ -0,0 +1,81 @@
+#include "AutoExposure.h"
+#include <GLFW/glfw3.h>
+#include <cmath>
+
+AutoExposure::AutoExposure()
+    : minLogLuminance(-10.0f), maxLogLuminance(4.0f), keyValue(0.18f), adaptationRate(1.5f),
+    minExposure(0.1f), maxExposure(10.0f), lastTime(-1.0) {
+    histogramShader = new Shader("assets/shaders/luminance_histogram.comp");
+    averageShader = new Shader("assets/shaders/luminance_average.comp");
+
+    histogramShader->use();
+    histogramShader->setInt("hdrScene", 0);
+    resolveUniforms();
+
+    unsigned int zeros[256] = { 0 };
+    glGenBuffers(1, &histogramSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, histogramSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(zeros), zeros, GL_DYNAMIC_COPY);
+
+    // start at exposure 1
+    float exposure[2] = { keyValue, 1.0f };
+    glGenBuffers(1, &exposureSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, exposureSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(exposure), exposure, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void AutoExposure::resolveUniforms() {
+    shaderReloads = Shader::reloads;
+    histogramUniforms.minLogLuminance = histogramShader->GetUniform<float>(UniformName("minLogLuminance"));
+    histogramUniforms.inverseLogLuminanceRange = histogramShader->GetUniform<float>(UniformName("inverseLogLuminanceRange"));
+    averageUniforms.pixelCount = averageShader->GetUniform<unsigned int>(UniformName("pixelCount"));
+    averageUniforms.minLogLuminance = averageShader->GetUniform<float>(UniformName("minLogLuminance"));
+    averageUniforms.logLuminanceRange = averageShader->GetUniform<float>(UniformName("logLuminanceRange"));
+    averageUniforms.adaptation = averageShader->GetUniform<float>(UniformName("adaptation"));
+    averageUniforms.keyValue = averageShader->GetUniform<float>(UniformName("keyValue"));
+    averageUniforms.minExposure = averageShader->GetUniform<float>(UniformName("minExposure"));
+    averageUniforms.maxExposure = averageShader->GetUniform<float>(UniformName("maxExposure"));
+}
+
+AutoExposure::~AutoExposure() {
+    delete histogramShader;
+    delete averageShader;
+    glDeleteBuffers(1, &histogramSSBO);
+    glDeleteBuffers(1, &exposureSSBO);
+}
+
+void AutoExposure::Compute(unsigned int hdrTexture, int width, int height) {
+    double now = glfwGetTime();
+    float deltaTime = lastTime < 0.0 ? 0.0f : (float)(now - lastTime);
+    lastTime = now;
+    if (shaderReloads != Shader::reloads) resolveUniforms();
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, HISTOGRAM_SSBO_BINDING, histogramSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, EXPOSURE_SSBO_BINDING, exposureSSBO);
+    float range = maxLogLuminance - minLogLuminance;
+
+    // 1. Histogram (bins were cleared by last frame's average pass)
+    histogramUniforms.minLogLuminance.Set(minLogLuminance);
+    histogramUniforms.inverseLogLuminanceRange.Set(1.0f / range);
+    histogramShader->use();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, hdrTexture);
+    glDispatchCompute((width + 15) / 16, (height + 15) / 16, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    // 2. Average + adaptation, first frame jumps straight to the target
+    averageUniforms.pixelCount.Set((unsigned int)(width * height));
+    averageUniforms.minLogLuminance.Set(minLogLuminance);
+    averageUniforms.logLuminanceRange.Set(range);
+    averageUniforms.adaptation.Set(deltaTime > 0.0f ? 1.0f - std::exp(-deltaTime * adaptationRate) : 1.0f);
+    averageUniforms.keyValue.Set(keyValue);
+    averageUniforms.minExposure.Set(minExposure);
+    averageUniforms.maxExposure.Set(maxExposure);
+    averageShader->use();
+    glDispatchCompute(1, 1, 1);
+}
+
+void AutoExposure::Bind() {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, EXPOSURE_SSBO_BINDING, exposureSSBO);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <glad/glad.h>
+#include "../Shader.h"
+
+// SSBO binding points of the exposure stage (after the light SSBOs)
+const unsigned int EXPOSURE_SSBO_BINDING = 3;
+const unsigned int HISTOGRAM_SSBO_BINDING = 4;
+
+// Log luminance histogram of the HDR scene -> eye adapted exposure, all on the GPU.
+// The tonemap reads the exposure straight from the SSBO, nothing is read back.
+class AutoExposure {
+public:
+    unsigned int histogramSSBO; // 256 uint bins
+    unsigned int exposureSSBO;  // float averageLuminance, float exposure
+
+    Shader* histogramShader;
+    Shader* averageShader;
+
+    float minLogLuminance, maxLogLuminance; // histogram range (log2)
+    float keyValue;       // average luminance -> exposure = keyValue / average
+    float adaptationRate; // per second, eye adaptation speed
+    float minExposure, maxExposure;
+
+    AutoExposure();
+    ~AutoExposure();
+
+    // Readers of the exposure need a GL_SHADER_STORAGE_BARRIER_BIT first
+    void Compute(unsigned int hdrTexture, int width, int height);
+    void Bind(); // exposure SSBO for the tonemap
+
+private:
+    double lastTime;
+
+    // resolved once, again after shader reloads
+    struct HistogramUniforms {
+        UniformHandle<float> minLogLuminance, inverseLogLuminanceRange;
+    };
+    struct AverageUniforms {
+        UniformHandle<unsigned int> pixelCount;
+        UniformHandle<float> minLogLuminance, logLuminanceRange, adaptation, keyValue, minExposure, maxExposure;
+    };
+    HistogramUniforms histogramUniforms;
+    AverageUniforms averageUniforms;
+    unsigned int shaderReloads; // Shader::reloads the handles were resolved at
+
+    void resolveUniforms();
+};
@@ -1,114 +1,323 @@
 #include "DeferredRenderer.h"
 #include <glm/gtc/type_ptr.hpp>
-#include "stb_image.h"
+#include <algorithm>
+#include <cmath>
 
-DeferredRenderer::DeferredRenderer(int w, int h) : width(w), height(h) {
+DeferredRenderer::DeferredRenderer(int w, int h) : width(w), height(h), nearPlane(0.1f), farPlane(100.0f), lightingMode(LightingMode::Clustered),
+    quality(RenderQuality::High), aoMode(AOMode::SSAO), autoExposureEnabled(true), frameCamera(nullptr), graphDirty(true),
+    shaderReloads(Shader::reloads) {
+    textureStreamer = new TextureStreamer();
+    targetPool = new RenderTargetPool();
     gBuffer = new GBuffer(w, h);
-    postProcessor = new PostProcessor(w, h);
-    ssao = new SSAO(w, h);
+    postProcessor = new PostProcessor(w, h, targetPool);
+    ssao = new SSAO(w, h, targetPool);
+    gtao = new GTAO(w, h);
+    lightClusters = new LightClusters();
+    lightBuffer = new LightBuffer(MAX_LIGHTS);
+    volumetricFog = new VolumetricFog();
+    lightProxies = new LightProxyRenderer();
+    autoExposure = new AutoExposure();
+    frameGraph = new FrameGraph();
 
-    gBufferShader = new Shader("assets/shaders/gbuffer.vert", "assets/shaders/gbuffer.frag");
-    lightingShader = new Shader("assets/shaders/deferred_shading.vert", "assets/shaders/deferred_shading.frag");
-    lightBoxShader = new Shader("assets/shaders/light_box.vert", "assets/shaders/light_box.frag");
+    unsigned char white[4] = { 255, 255, 255, 255 };
+    glGenTextures(1, &whiteTexture);
+    glBindTexture(GL_TEXTURE_2D, whiteTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-    lightingShader->use();
-    lightingShader->setInt("gPosition", 0);
-    lightingShader->setInt("gNormal", 1);
-    lightingShader->setInt("gAlbedoSpec", 2);
-    lightingShader->setInt("ssao", 3);
-    lightingShader->setInt("gEmission", 4);
+    glGenBuffers(1, &clusterSSBO);
+    glGenBuffers(1, &lightIndexSSBO);
+
+    gBufferShader = new Shader("assets/shaders/gbuffer.vert", "assets/shaders/gbuffer.frag");
+    gBufferCompactShader = new Shader("assets/shaders/gbuffer_compact.vert", "assets/shaders/gbuffer.frag");
+    lightingVariants = new ShaderVariants("assets/shaders/debug_quad.vert", "assets/shaders/deferred_shading.frag",
+        { "COMPACT_GBUFFER", "SURFACE_LIGHTS", "AMBIENT_OCCLUSION" }, [](Shader& shader) {
+            shader.setInt("gPosition", 0);
+            shader.setInt("gNormal", 1);
+            shader.setInt("gAlbedoSpec", 2);
+            shader.setInt("ssao", 3);
+            shader.setInt("gEmission", 4);
+            shader.setInt("fogVolume", 5);
+            shader.setInt("gDepth", 6);
+        });
+    lightVolumeVariants = new ShaderVariants("assets/shaders/light_volume.vert", "assets/shaders/light_volume.frag",
+        { "COMPACT_GBUFFER" }, [](Shader& shader) {
+            shader.setInt("gPosition", 0);
+            shader.setInt("gNormal", 1);
+            shader.setInt("gAlbedoSpec", 2);
+            shader.setInt("fogVolume", 5);
+            shader.setInt("gDepth", 6);
+        });
+    // submit the starting variants now, uniforms are resolved on first use (selectLightingVariants),
+    // the other variants compile the first time the layout / mode / quality asks for them
+    lightingShader = nullptr;
+    lightVolumeShader = nullptr;
+    lightingVariants->Get(getLightingVariant());
+    lightVolumeVariants->Get(getLightingVariant() & LIGHTING_COMPACT_GBUFFER);
 
-    buildingNormalMap = loadTexture("assets/textures/building_normal.jpg");
+    // flat normal until the real map is streamed in
+    buildingNormalMap = textureStreamer->Load2D("assets/textures/building_normal.jpg", glm::vec4(0.5f, 0.5f, 1.0f, 1.0f));
     gBufferShader->use();
     gBufferShader->setInt("normalMap", 1);
+    gBufferCompactShader->use();
+    gBufferCompactShader->setInt("normalMap", 1);
+
+    resolveGeometryUniforms();
+}
+
+void DeferredRenderer::resolveGeometryUniforms() {
+    Shader* geometryShaders[2] = { gBufferShader, gBufferCompactShader };
+    for (int i = 0; i < 2; i++) {
+        geometryUniforms[i].projection = geometryShaders[i]->GetUniform<glm::mat4>(UniformName("projection"));
+        geometryUniforms[i].view = geometryShaders[i]->GetUniform<glm::mat4>(UniformName("view"));
+        geometryUniforms[i].compactGBuffer = geometryShaders[i]->GetUniform<bool>(UniformName("compactGBuffer"));
+    }
+}
+
+uint32_t DeferredRenderer::getLightingVariant() const {
+    uint32_t variant = 0;
+    if (gBuffer->layout == GBufferLayout::Compact) variant |= LIGHTING_COMPACT_GBUFFER;
+    if (lightingMode == LightingMode::Clustered) variant |= LIGHTING_SURFACE_LIGHTS;
+    if (quality == RenderQuality::High) variant |= LIGHTING_AMBIENT_OCCLUSION; // same condition as getAOTexture
+    return variant;
+}
+
+void DeferredRenderer::selectLightingVariants() {
+    uint32_t variant = getLightingVariant();
+    Shader* shaders[2] = { lightingVariants->Get(variant), lightVolumeVariants->Get(variant & LIGHTING_COMPACT_GBUFFER) };
+    Shader** current[2] = { &lightingShader, &lightVolumeShader };
+    LightingUniforms* lighting[2] = { &lightingUniforms, &lightVolumeUniforms };
+    for (int i = 0; i < 2; i++) {
+        if (*current[i] == shaders[i]) continue;
+        *current[i] = shaders[i];
+        lighting[i]->projection = shaders[i]->GetUniform<glm::mat4>(UniformName("projection"));
+        lighting[i]->view = shaders[i]->GetUniform<glm::mat4>(UniformName("view"));
+        lighting[i]->viewPos = shaders[i]->GetUniform<glm::vec3>(UniformName("viewPos"));
+        lighting[i]->uTime = shaders[i]->GetUniform<float>(UniformName("uTime"));
+        lighting[i]->zNear = shaders[i]->GetUniform<float>(UniformName("zNear"));
+        lighting[i]->zFar = shaders[i]->GetUniform<float>(UniformName("zFar"));
+        lighting[i]->tanHalfFovY = shaders[i]->GetUniform<float>(UniformName("tanHalfFovY"));
+        lighting[i]->aspect = shaders[i]->GetUniform<float>(UniformName("aspect"));
+    }
 }
 
 DeferredRenderer::~DeferredRenderer() {
     delete gBuffer;
     delete postProcessor;
     delete gBufferShader;
-    delete lightingShader;
-    delete lightBoxShader;
+    delete gBufferCompactShader;
+    delete lightingVariants;
+    delete lightVolumeVariants;
     delete ssao;
+    delete gtao;
+    delete lightClusters;
+    delete lightBuffer;
+    delete volumetricFog;
+    delete lightProxies;
+    delete autoExposure;
+    delete frameGraph;
+    glDeleteTextures(1, &whiteTexture);
+    glDeleteBuffers(1, &clusterSSBO);
+    glDeleteBuffers(1, &lightIndexSSBO);
+    delete targetPool;
+    delete textureStreamer;
+}
+
+glm::mat4 DeferredRenderer::GetProjection(Camera& camera) {
+    return glm::perspective(glm::radians(camera.Zoom), (float)width / (float)height, nearPlane, farPlane);
 }
 
 void DeferredRenderer::BeginGeometryPass(Camera& camera) {
+    gBuffer->Acquire(targetPool);
     glBindFramebuffer(GL_FRAMEBUFFER, gBuffer->gBuffer);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    gBufferShader->use();
-    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)width / (float)height, 0.1f, 100.0f);
+    glm::mat4 projection = GetProjection(camera);
     glm::mat4 view = camera.GetViewMatrix();
-    gBufferShader->setMat4("projection", glm::value_ptr(projection));
-    gBufferShader->setMat4("view", glm::value_ptr(view));
+    // both programs share gbuffer.frag
+    bool compact = gBuffer->layout == GBufferLayout::Compact;
+    for (const GeometryUniforms& uniforms : geometryUniforms) {
+        uniforms.projection.Set(projection);
+        uniforms.view.Set(view);
+        uniforms.compactGBuffer.Set(compact);
+    }
 
     glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, buildingNormalMap);
+    glBindTexture(GL_TEXTURE_2D, buildingNormalMap->texture);
+}
+
+void DeferredRenderer::Resize(int w, int h) {
+    if (w <= 0 || h <= 0 || (w == width && h == height)) return; // minimized / unchanged
+    width = w;
+    height = h;
+
+    // every target is released by the end of a frame, drop the old sizes right away
+    gBuffer->Release(targetPool);
+    gBuffer->width = w;
+    gBuffer->height = h;
+    postProcessor->Resize(w, h);
+    ssao->Resize(w, h);
+    gtao->Resize(w, h);
+    targetPool->Clear();
+}
+
+void DeferredRenderer::SetGBufferLayout(GBufferLayout layout) {
+    if (gBuffer->layout == layout) return;
+    gBuffer->Release(targetPool);
+    delete gBuffer;
+    gBuffer = new GBuffer(width, height, layout);
+}
+
+Shader* DeferredRenderer::GetGeometryShader(InstanceLayout layout) {
+    return layout == InstanceLayout::Compact ? gBufferCompactShader : gBufferShader;
 }
 
 void DeferredRenderer::EndGeometryPass() {
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+void DeferredRenderer::ComputeSSAO(Camera& camera) {
+    glm::mat4 projection = GetProjection(camera);
+    glm::mat4 view = camera.GetViewMatrix();
+    ssao->Compute(gBuffer, projection, view);
+    ssao->Blur(gBuffer, projection, view);
+}
+
+void DeferredRenderer::ComputeGTAO(Camera& camera) {
+    gtao->Compute(gBuffer, GetProjection(camera), camera.GetViewMatrix());
+}
+
+unsigned int DeferredRenderer::getAOTexture() {
+    if (quality != RenderQuality::High) return whiteTexture; // AO pass culled
+    if (aoMode == AOMode::GTAO) return gtao->GetAOTexture();
+    return ssao->ssaoBlurTarget ? ssao->GetSSAOTexture() : whiteTexture;
+}
+
+void DeferredRenderer::ComputeFog(Camera& camera) {
+    lightBuffer->Bind(LIGHT_SSBO_BINDING);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_SSBO_BINDING, clusterSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_INDEX_SSBO_BINDING, lightIndexSSBO);
+
+    // froxel inject + integrate, reads the light clusters
+    volumetricFog->Compute(camera.GetViewMatrix(), camera.Position, glm::radians(camera.Zoom), (float)width / (float)height, nearPlane, farPlane);
+}
+
 void DeferredRenderer::BeginLightingPass(Camera& camera) {
-    // 1. SSAO
-    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)width / (float)height, 0.1f, 100.0f);
+    glm::mat4 projection = GetProjection(camera);
     glm::mat4 view = camera.GetViewMatrix();
+    float fovY = glm::radians(camera.Zoom);
+    float aspect = (float)width / (float)height;
 
-    ssao->Compute(gBuffer->gPosition, gBuffer->gNormal, projection, view);
-    ssao->Blur();
+    currentProjection = projection;
+    currentView = view;
+    currentViewPos = camera.Position;
+
+    lightBuffer->Bind(LIGHT_SSBO_BINDING);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_SSBO_BINDING, clusterSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_INDEX_SSBO_BINDING, lightIndexSSBO);
 
-    // 2. Lighting Pass
     postProcessor->BeginRender(); // bind HDR FBO
 
+    selectLightingVariants();
     lightingShader->use();
     glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, gBuffer->gPosition);
     glActiveTexture(GL_TEXTURE1); glBindTexture(GL_TEXTURE_2D, gBuffer->gNormal);
     glActiveTexture(GL_TEXTURE2); glBindTexture(GL_TEXTURE_2D, gBuffer->gAlbedoSpec);
-    glActiveTexture(GL_TEXTURE3); glBindTexture(GL_TEXTURE_2D, ssao->GetSSAOTexture());
+    glActiveTexture(GL_TEXTURE3); glBindTexture(GL_TEXTURE_2D, getAOTexture());
 
     glActiveTexture(GL_TEXTURE4);
     glBindTexture(GL_TEXTURE_2D, gBuffer->gEmission);
+    glActiveTexture(GL_TEXTURE5);
+    glBindTexture(GL_TEXTURE_3D, volumetricFog->GetVolumeTexture());
+    glActiveTexture(GL_TEXTURE6);
+    glBindTexture(GL_TEXTURE_2D, gBuffer->gDepth);
+
+    lightingUniforms.viewPos.Set(camera.Position);
+    lightingUniforms.uTime.Set((float)glfwGetTime());
 
-    lightingShader->setVec3("viewPos", camera.Position);
-    lightingShader->setFloat("uTime", glfwGetTime());
+    // cluster lookup
+    lightingUniforms.view.Set(view);
+    lightingUniforms.zNear.Set(nearPlane);
+    lightingUniforms.zFar.Set(farPlane);
+    lightingUniforms.tanHalfFovY.Set(std::tan(fovY * 0.5f));
+    lightingUniforms.aspect.Set(aspect);
 }
 
-unsigned int DeferredRenderer::loadTexture(char const* path) {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+// orphan + refill, SSBOs must never be zero-sized when bound
+static void uploadSSBO(unsigned int ssbo, size_t size, const void* data) {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, ssbo);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, size > 0 ? size : 16, size > 0 ? data : NULL, GL_STREAM_DRAW);
+}
 
-    int width, height, nrComponents;
-    unsigned char* data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data) {
-        GLenum format;
-        if (nrComponents == 1) format = GL_RED;
-        else if (nrComponents == 3) format = GL_RGB;
-        else if (nrComponents == 4) format = GL_RGBA;
+void DeferredRenderer::UploadLights(const std::vector<PointLight>& lights, Camera& camera) {
+    lightBuffer->Write(lights);
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+    glm::mat4 view = camera.GetViewMatrix();
+    lightClusters->Build(lights.data(), lightBuffer->count, view, glm::radians(camera.Zoom), (float)width / (float)height, nearPlane, farPlane);
 
-        // �k�u�K�Ϥ@�w�n�� Repeat
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        // �Y�p�ɨϥΤT�u�ʹL�o�A�קK�{�{
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    uploadClusters();
+}
 
-        stbi_image_free(data);
-    }
-    else {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-    return textureID;
+void DeferredRenderer::UploadLights(const LightSystem& lights, Camera& camera) {
+    lightBuffer->count = std::min(lights.GetCount(), lightBuffer->capacity);
+
+    glm::mat4 view = camera.GetViewMatrix();
+    lightClusters->Build(lights.posX.data(), lights.posY.data(), lights.posZ.data(), lights.radius.data(), lightBuffer->count,
+        view, glm::radians(camera.Zoom), (float)width / (float)height, nearPlane, farPlane);
+
+    uploadClusters();
+}
+
+void DeferredRenderer::uploadClusters() {
+    const std::vector<ClusterRange>& clusters = lightClusters->GetClusters();
+    const std::vector<uint32_t>& indices = lightClusters->GetLightIndices();
+
+    uploadSSBO(clusterSSBO, clusters.size() * sizeof(ClusterRange), clusters.data());
+    uploadSSBO(lightIndexSSBO, indices.size() * sizeof(uint32_t), indices.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
 
 void DeferredRenderer::EndLightingPass() {
     Primitives::renderQuad();
+
+    if (lightingMode == LightingMode::LightVolumes)
+        renderLightVolumes();
+}
+
+void DeferredRenderer::renderLightVolumes() {
+    // scene depth for rejection (the full-screen quad wrote its own depth)
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer->gBuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, postProcessor->hdrFBO);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, postProcessor->hdrFBO);
+
+    lightVolumeShader->use();
+    lightVolumeUniforms.projection.Set(currentProjection);
+    lightVolumeUniforms.view.Set(currentView);
+    lightVolumeUniforms.viewPos.Set(currentViewPos);
+    lightVolumeUniforms.zNear.Set(nearPlane);
+    lightVolumeUniforms.zFar.Set(farPlane);
+    lightVolumeUniforms.tanHalfFovY.Set(1.0f / currentProjection[1][1]);
+    lightVolumeUniforms.aspect.Set((float)width / (float)height);
+
+    // back faces + GEQUAL: only pixels whose surface lies in front of the sphere's far side,
+    // also correct when the camera is inside the volume
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_FRONT);
+    glDepthFunc(GL_GEQUAL);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+
+    Primitives::renderSphere(lightBuffer->count);
+
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+    glDepthFunc(GL_LESS);
+    glCullFace(GL_BACK);
+    glDisable(GL_CULL_FACE);
 }
 
 void DeferredRenderer::BeginForwardPass(Camera& camera) {
@@ -116,21 +325,152 @@ void DeferredRenderer::BeginForwardPass(Camera& camera) {
     glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer->gBuffer);
     glBindFramebuffer(GL_DRAW_FRAMEBUFFER, postProcessor->hdrFBO);
     glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-
     glBindFramebuffer(GL_FRAMEBUFFER, postProcessor->hdrFBO);
 
-    lightBoxShader->use();
-    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)width / (float)height, 0.1f, 100.0f);
-    glm::mat4 view = camera.GetViewMatrix();
-    lightBoxShader->setMat4("projection", glm::value_ptr(projection));
-    lightBoxShader->setMat4("view", glm::value_ptr(view));
+    currentProjection = GetProjection(camera);
+    currentView = camera.GetViewMatrix();
+    currentViewPos = camera.Position;
+}
+
+void DeferredRenderer::DrawLightProxies() {
+    lightBuffer->Bind(LIGHT_SSBO_BINDING);
+    lightProxies->Draw(lightBuffer->count, currentView, currentProjection, currentViewPos);
 }
 
 void DeferredRenderer::EndForwardPass() {
     postProcessor->EndRender(); // unbind FBO
 }
 
-void DeferredRenderer::RenderPostProcess() {
-    postProcessor->RenderBloom();
-    postProcessor->RenderFinal(1.0f);
+void DeferredRenderer::endFrame() {
+    // last user of this frame's light region
+    lightBuffer->EndFrame();
+    targetPool->EndFrame();
+}
+
+void DeferredRenderer::SetQuality(RenderQuality quality) {
+    if (this->quality == quality) return;
+    this->quality = quality;
+    gtao->ResetHistory(); // the AO pass may have been culled, or ran with other settings
+    graphDirty = true;
+}
+
+void DeferredRenderer::SetAOMode(AOMode mode) {
+    if (aoMode == mode) return;
+    aoMode = mode;
+    gtao->ResetHistory(); // history is stale after frames without GTAO
+    graphDirty = true;
+}
+
+void DeferredRenderer::SetAutoExposure(bool enabled) {
+    if (autoExposureEnabled == enabled) return;
+    autoExposureEnabled = enabled;
+    graphDirty = true;
+}
+
+void DeferredRenderer::RenderFrame(Camera& camera, std::function<void()> drawGeometry, std::function<void()> drawForward) {
+    frameCamera = &camera;
+    frameGeometry = drawGeometry;
+    frameForward = drawForward;
+
+    textureStreamer->Update();
+
+    // hot reload swapped programs since the last frame: handles point at deleted programs
+    if (shaderReloads != Shader::reloads) {
+        shaderReloads = Shader::reloads;
+        resolveGeometryUniforms();
+        lightingShader = nullptr; // re-resolved by selectLightingVariants
+        lightVolumeShader = nullptr;
+    }
+
+    if (graphDirty) buildFrameGraph();
+    frameGraph->Execute();
+    endFrame();
+}
+
+// Pool targets are acquired by the pass writing them and handed back by the graph after their last reader
+void DeferredRenderer::buildFrameGraph() {
+    frameGraph->Clear();
+    FrameGraph& graph = *frameGraph;
+
+    FrameGraphResource gbuffer = graph.CreateResource("gbuffer", nullptr, [this]() { gBuffer->Release(targetPool); });
+    FrameGraphResource ao = graph.CreateResource("ao", nullptr, [this]() { ssao->Release(); }, GL_TEXTURE_FETCH_BARRIER_BIT);
+    FrameGraphResource lights = graph.CreateResource("lights"); // uploaded before the graph runs
+    FrameGraphResource fog = graph.CreateResource("fog", nullptr, nullptr, GL_TEXTURE_FETCH_BARRIER_BIT);
+    FrameGraphResource hdr = graph.CreateResource("hdr", nullptr, [this]() { postProcessor->Release(); });
+    FrameGraphResource bloom = graph.CreateResource("bloom", nullptr, [this]() { postProcessor->ReleaseBloom(); });
+    FrameGraphResource exposure = graph.CreateResource("exposure", nullptr, nullptr, GL_SHADER_STORAGE_BARRIER_BIT);
+
+    bool aoEnabled = quality == RenderQuality::High;
+    bool bloomEnabled = quality != RenderQuality::Low;
+
+    graph.AddPass("Geometry", PassType::Raster,
+        [&](FrameGraphBuilder& builder) { builder.Write(gbuffer); },
+        [this]() {
+            BeginGeometryPass(*frameCamera);
+            frameGeometry();
+            EndGeometryPass();
+        });
+
+    if (aoMode == AOMode::SSAO) {
+        graph.AddPass("SSAO", PassType::Raster,
+            [&](FrameGraphBuilder& builder) { builder.Read(gbuffer); builder.Write(ao); },
+            [this]() { ComputeSSAO(*frameCamera); });
+    }
+    else {
+        graph.AddPass("GTAO", PassType::Compute,
+            [&](FrameGraphBuilder& builder) { builder.Read(gbuffer); builder.Write(ao); },
+            [this]() { ComputeGTAO(*frameCamera); });
+    }
+
+    graph.AddPass("VolumetricFog", PassType::Compute,
+        [&](FrameGraphBuilder& builder) { builder.Read(lights); builder.Write(fog); },
+        [this]() { ComputeFog(*frameCamera); });
+
+    graph.AddPass("Lighting", PassType::Raster,
+        [&](FrameGraphBuilder& builder) {
+            builder.Read(gbuffer);
+            builder.Read(lights);
+            builder.Read(fog);
+            if (aoEnabled) builder.Read(ao); // otherwise the AO pass is culled, AO falls back to white
+            builder.Write(hdr);
+        },
+        [this]() {
+            BeginLightingPass(*frameCamera);
+            EndLightingPass();
+        });
+
+    graph.AddPass("Forward", PassType::Raster,
+        [&](FrameGraphBuilder& builder) { builder.Read(gbuffer); builder.Read(lights); builder.Read(hdr); builder.Write(hdr); }, // blends over the lit image
+        [this]() {
+            BeginForwardPass(*frameCamera);
+            DrawLightProxies();
+            frameForward();
+            EndForwardPass();
+        });
+
+    graph.AddPass("Bloom", PassType::Raster,
+        [&](FrameGraphBuilder& builder) { builder.Read(hdr); builder.Write(bloom); },
+        [this]() { postProcessor->RenderBloom(); });
+
+    // metered before bloom is added, bloom stays relative to the scene
+    graph.AddPass("AutoExposure", PassType::Compute,
+        [&](FrameGraphBuilder& builder) { builder.Read(hdr); builder.Write(exposure); },
+        [this]() { autoExposure->Compute(postProcessor->colorBuffer, width, height); });
+
+    bool adaptive = autoExposureEnabled;
+    graph.AddPass("Final", PassType::Raster,
+        [&](FrameGraphBuilder& builder) {
+            builder.Read(hdr);
+            if (bloomEnabled) builder.Read(bloom);
+            if (adaptive) builder.Read(exposure);
+            builder.SideEffect(); // presents
+        },
+        [this, adaptive]() {
+            autoExposure->Bind();
+            postProcessor->RenderFinal(1.0f, adaptive);
+        });
+
+    graph.Compile();
+    graphDirty = false;
+    std::cout << "Frame graph: " << graph.Describe() << std::endl;
 }
\ No newline at end of file
@@ -2,23 +2,82 @@
 #include "../GBuffer.h"
 #include "PostProcessor.h"
 #include "../Shader.h"
+#include "../ShaderVariants.h"
 #include "../Camera.h"
 #include "SSAO.h"
+#include "GTAO.h"
+#include "PointLight.h"
+#include "LightClusters.h"
+#include "LightBuffer.h"
+#include "LightSystem.h"
+#include "VolumetricFog.h"
+#include "LightProxyRenderer.h"
+#include "InstancedMesh.h"
+#include "FrameGraph.h"
+#include "AutoExposure.h"
+#include "TextureStreamer.h"
 #include <GLFW/glfw3.h>
+#include <functional>
+#include <vector>
+
+const unsigned int MAX_LIGHTS = 16384;
+
+// Variant bits of the lighting programs (option order of lightingVariants, light volumes only use the first)
+const uint32_t LIGHTING_COMPACT_GBUFFER = 1u << 0;   // position from depth, octahedral normals
+const uint32_t LIGHTING_SURFACE_LIGHTS = 1u << 1;    // clustered point lights in the full-screen pass
+const uint32_t LIGHTING_AMBIENT_OCCLUSION = 1u << 2; // AO pass runs at this quality tier
+
+enum class LightingMode {
+    Clustered,    // full-screen pass, per-cluster light lists
+    LightVolumes  // full-screen pass for ambient/fog + one instanced bounding sphere per light
+};
+
+enum class AOMode {
+    SSAO, // hemisphere kernel, reduced resolution + bilateral upsample
+    GTAO  // horizon based compute pass with temporal accumulation
+};
+
+// Effects per tier, the frame graph drops the passes nobody reads
+enum class RenderQuality {
+    Low,    // no AO, no bloom
+    Medium, // bloom
+    High    // AO (SSAO or GTAO) + bloom
+};
 
 class DeferredRenderer {
 public:
+    RenderTargetPool* targetPool; // transient targets of GBuffer, SSAO and PostProcessor
     GBuffer* gBuffer;
     PostProcessor* postProcessor;
 
-    Shader* gBufferShader;
-    Shader* lightingShader;
-    Shader* lightBoxShader;
+    Shader* gBufferShader;        // mat4 instances
+    Shader* gBufferCompactShader; // CompactInstance instances
+    ShaderVariants* lightingVariants;    // deferred_shading.frag, LIGHTING_* bits
+    ShaderVariants* lightVolumeVariants; // light_volume.frag, LIGHTING_COMPACT_GBUFFER
+    Shader* lightingShader;    // variants of the current G-buffer layout / lighting mode / quality
+    Shader* lightVolumeShader;
 
     SSAO* ssao;
+    GTAO* gtao;
+    LightClusters* lightClusters;
+    LightBuffer* lightBuffer;
+    VolumetricFog* volumetricFog;
+    LightProxyRenderer* lightProxies;
+    AutoExposure* autoExposure;
+    FrameGraph* frameGraph;
+    unsigned int whiteTexture; // AO input when SSAO is off
+
+    // cluster lists (std430 SSBOs)
+    unsigned int clusterSSBO, lightIndexSSBO;
 
     int width, height;
-    unsigned int buildingNormalMap;
+    float nearPlane, farPlane;
+    LightingMode lightingMode;
+    RenderQuality quality;
+    AOMode aoMode;
+    bool autoExposureEnabled; // off: fixed exposure 1
+    TextureStreamer* textureStreamer;
+    StreamedTexture* buildingNormalMap;
 
     DeferredRenderer(int w, int h);
     ~DeferredRenderer();
@@ -26,13 +85,60 @@ public:
     // �y�{���� API
     void BeginGeometryPass(Camera& camera);
     void EndGeometryPass();
+    Shader* GetGeometryShader(InstanceLayout layout); // G-buffer program matching an instance layout
+    void SetGBufferLayout(GBufferLayout layout); // recreates the G-buffer targets
+    void Resize(int w, int h); // window resize, targets are reallocated at the new size on next use
+    void SetQuality(RenderQuality quality); // rebuilds the frame graph
+    void SetAOMode(AOMode mode);            // same
+    void SetAutoExposure(bool enabled);     // same
 
+    // Whole frame through the frame graph (after UploadLights):
+    // drawGeometry runs inside the geometry pass, drawForward inside the forward pass
+    void RenderFrame(Camera& camera, std::function<void()> drawGeometry, std::function<void()> drawForward);
+
+    void UploadLights(const std::vector<PointLight>& lights, Camera& camera); // cluster binning + SSBO upload, before BeginLightingPass
+    void UploadLights(const LightSystem& lights, Camera& camera); // lights already written to lightBuffer->Map() by LightSystem::Update
+    void ComputeSSAO(Camera& camera);
+    void ComputeGTAO(Camera& camera); // compute pass, needs a texture fetch barrier before the lighting pass
+    void ComputeFog(Camera& camera); // sampled by the lighting pass after a texture fetch barrier
     void BeginLightingPass(Camera& camera);
     void EndLightingPass();
 
     void BeginForwardPass(Camera& camera);
+    void DrawLightProxies(); // one instanced draw for every light marker
     void EndForwardPass();
 
-    void RenderPostProcess(); // Bloom + Tone Mapping
-    unsigned int loadTexture(char const* path);
+    glm::mat4 GetProjection(Camera& camera);
+
+private:
+    glm::mat4 currentProjection, currentView; // camera of the current lighting pass
+    glm::vec3 currentViewPos;
+
+    // per frame uniforms, resolved once after link
+    struct GeometryUniforms {
+        UniformHandle<glm::mat4> projection, view;
+        UniformHandle<bool> compactGBuffer;
+    };
+    struct LightingUniforms {
+        UniformHandle<glm::mat4> projection, view; // projection: light volumes only
+        UniformHandle<glm::vec3> viewPos;
+        UniformHandle<float> uTime, zNear, zFar, tanHalfFovY, aspect;
+    };
+    GeometryUniforms geometryUniforms[2]; // gBufferShader, gBufferCompactShader
+    LightingUniforms lightingUniforms, lightVolumeUniforms;
+
+    // per frame inputs of the graph passes
+    Camera* frameCamera;
+    std::function<void()> frameGeometry, frameForward;
+    bool graphDirty;
+    unsigned int shaderReloads; // Shader::reloads the handles were resolved at
+
+    void resolveGeometryUniforms();
+    uint32_t getLightingVariant() const;
+    void selectLightingVariants(); // re-resolves the uniform handles when a variant changes
+    void uploadClusters();
+    void renderLightVolumes();
+    void buildFrameGraph();
+    unsigned int getAOTexture();
+    void endFrame();
 };
\ No newline at end of file
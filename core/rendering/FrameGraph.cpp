@@ -0,0 +1,234 @@
+#include "FrameGraph.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+FrameGraph::FrameGraph() : timingEnabled(true), compiled(false) {
+}
+
+FrameGraph::~FrameGraph() {
+    for (auto& timer : timers) delete timer.second;
+}
+
+FrameGraphResource FrameGraph::CreateResource(const std::string& name, std::function<void()> realize,
+    std::function<void()> release, GLbitfield readBarrier) {
+    Resource resource;
+    resource.name = name;
+    resource.realize = realize;
+    resource.release = release;
+    resource.readBarrier = readBarrier;
+    resource.firstPass = resource.lastPass = -1;
+    resource.pendingBarrier = false;
+    resources.push_back(resource);
+    compiled = false;
+    return (FrameGraphResource)resources.size() - 1;
+}
+
+void FrameGraph::AddPass(const std::string& name, PassType type, std::function<void(FrameGraphBuilder&)> setup, std::function<void()> execute) {
+    Pass pass;
+    pass.name = name;
+    pass.type = type;
+    pass.execute = execute;
+    pass.culled = false;
+    setup(pass.io);
+    passes.push_back(pass);
+    compiled = false;
+}
+
+void FrameGraph::Clear() {
+    resources.clear();
+    passes.clear();
+    order.clear();
+    timings.clear();
+    compiled = false;
+}
+
+static bool contains(const std::vector<FrameGraphResource>& list, FrameGraphResource resource) {
+    return std::find(list.begin(), list.end(), resource) != list.end();
+}
+
+void FrameGraph::Compile() {
+    size_t count = passes.size();
+
+    // 1. dependencies, whatever the declaration order: readers see the final contents of a resource.
+    // Per resource: plain writers -> read-modify-writers -> plain readers,
+    // several writers of the same kind keep declaration order.
+    std::vector<std::vector<int>> dependents(count);
+    std::vector<int> inDegree(count, 0);
+    for (size_t b = 0; b < count; b++) {
+        for (size_t a = 0; a < count; a++) {
+            if (a == b) continue;
+            bool depends = false; // a before b
+            for (FrameGraphResource resource : passes[a].io.writes) {
+                bool aReads = contains(passes[a].io.reads, resource);
+                bool bReads = contains(passes[b].io.reads, resource);
+                bool bWrites = contains(passes[b].io.writes, resource);
+                if (bReads && !bWrites) depends = true;              // producer -> consumer
+                else if (bReads && bWrites && !aReads) depends = true; // writer -> modifier
+                else if (bWrites && aReads == bReads && a < b) depends = true; // same kind of writer
+            }
+            if (depends) {
+                dependents[a].push_back((int)b);
+                inDegree[b]++;
+            }
+        }
+    }
+
+    // 2. topological order, ties keep declaration order
+    order.clear();
+    std::vector<bool> scheduled(count, false);
+    while (order.size() < count) {
+        int next = -1;
+        for (size_t i = 0; i < count; i++)
+            if (!scheduled[i] && inDegree[i] == 0) { next = (int)i; break; }
+        if (next < 0) {
+            std::cout << "FrameGraph: dependency cycle, remaining passes skipped!" << std::endl;
+            break;
+        }
+        scheduled[next] = true;
+        order.push_back(next);
+        for (int dependent : dependents[next]) inDegree[dependent]--;
+    }
+
+    // 3. cull from the back: a pass lives if it has side effects or writes something a live pass reads
+    std::vector<bool> needed(resources.size(), false);
+    for (int i = (int)order.size() - 1; i >= 0; i--) {
+        Pass& pass = passes[order[i]];
+        bool alive = pass.io.sideEffect;
+        for (FrameGraphResource resource : pass.io.writes)
+            if (needed[resource]) alive = true;
+        pass.culled = !alive;
+        if (alive)
+            for (FrameGraphResource resource : pass.io.reads) needed[resource] = true;
+    }
+
+    // 4. lifetimes over the live passes
+    for (Resource& resource : resources) resource.firstPass = resource.lastPass = -1;
+    for (int i = 0; i < (int)order.size(); i++) {
+        const Pass& pass = passes[order[i]];
+        if (pass.culled) continue;
+        auto touch = [&](FrameGraphResource r) {
+            if (resources[r].firstPass < 0) resources[r].firstPass = i;
+            resources[r].lastPass = i;
+        };
+        for (FrameGraphResource resource : pass.io.reads) touch(resource);
+        for (FrameGraphResource resource : pass.io.writes) touch(resource);
+    }
+
+    compiled = true;
+}
+
+void FrameGraph::Execute() {
+    if (!compiled) Compile();
+
+    timings.clear();
+    for (int i = 0; i < (int)order.size(); i++) {
+        Pass& pass = passes[order[i]];
+        if (pass.culled) continue;
+
+        for (Resource& resource : resources)
+            if (resource.firstPass == i && resource.realize) resource.realize();
+
+        // make earlier compute writes visible
+        GLbitfield barrier = 0;
+        for (FrameGraphResource r : pass.io.reads) {
+            if (resources[r].pendingBarrier) {
+                barrier |= resources[r].readBarrier;
+                resources[r].pendingBarrier = false;
+            }
+        }
+        if (barrier) glMemoryBarrier(barrier);
+
+        GpuTimer* timer = nullptr;
+        if (timingEnabled) {
+            GpuTimer*& slot = timers[pass.name];
+            if (slot == nullptr) slot = new GpuTimer();
+            timer = slot;
+            timer->Begin();
+        }
+        pass.execute();
+        if (timer) {
+            timer->End();
+            timings.push_back({ pass.name, timer->GetMilliseconds() });
+        }
+
+        if (pass.type == PassType::Compute)
+            for (FrameGraphResource r : pass.io.writes)
+                if (resources[r].readBarrier) resources[r].pendingBarrier = true;
+
+        for (Resource& resource : resources)
+            if (resource.lastPass == i && resource.release) resource.release();
+    }
+}
+
+double FrameGraph::GetPassMilliseconds(const std::string& name) const {
+    for (const PassTiming& timing : timings)
+        if (timing.name == name) return timing.milliseconds;
+    return 0.0;
+}
+
+std::string FrameGraph::Describe() const {
+    std::ostringstream out;
+    for (size_t i = 0; i < order.size(); i++) {
+        const Pass& pass = passes[order[i]];
+        if (i > 0) out << " -> ";
+        out << pass.name;
+        if (pass.culled) out << " (culled)";
+    }
+    return out.str();
+}
+
+bool FrameGraph::RunSelfTest() {
+    bool passed = true;
+    auto check = [&](const char* name, const std::string& got, const std::string& expected) {
+        bool ok = got == expected;
+        if (!ok) passed = false;
+        std::cout << "  " << name << ": " << got << (ok ? "" : "   EXPECTED " + expected) << std::endl;
+    };
+    auto noop = []() {};
+
+    std::cout << "Frame graph ordering test" << std::endl;
+
+    // the deferred pipeline declared back to front
+    {
+        FrameGraph graph;
+        FrameGraphResource gbuffer = graph.CreateResource("gbuffer");
+        FrameGraphResource ao = graph.CreateResource("ao");
+        FrameGraphResource hdr = graph.CreateResource("hdr");
+        FrameGraphResource bloom = graph.CreateResource("bloom");
+        graph.AddPass("Final", PassType::Raster, [&](FrameGraphBuilder& b) { b.Read(hdr); b.Read(bloom); b.SideEffect(); }, noop);
+        graph.AddPass("Bloom", PassType::Raster, [&](FrameGraphBuilder& b) { b.Read(hdr); b.Write(bloom); }, noop);
+        graph.AddPass("Forward", PassType::Raster, [&](FrameGraphBuilder& b) { b.Read(gbuffer); b.Read(hdr); b.Write(hdr); }, noop);
+        graph.AddPass("Lighting", PassType::Raster, [&](FrameGraphBuilder& b) { b.Read(gbuffer); b.Read(ao); b.Write(hdr); }, noop);
+        graph.AddPass("SSAO", PassType::Compute, [&](FrameGraphBuilder& b) { b.Read(gbuffer); b.Write(ao); }, noop);
+        graph.AddPass("Geometry", PassType::Raster, [&](FrameGraphBuilder& b) { b.Write(gbuffer); }, noop);
+        graph.AddPass("Unused", PassType::Compute, [&](FrameGraphBuilder& b) { b.Read(gbuffer); }, noop);
+        graph.Compile();
+        check("reversed declaration", graph.Describe(), "Geometry -> SSAO -> Lighting -> Forward -> Bloom -> Final -> Unused (culled)");
+    }
+
+    // a read-modify-write pass runs after the plain writer even when declared first
+    {
+        FrameGraph graph;
+        FrameGraphResource color = graph.CreateResource("color");
+        graph.AddPass("Tonemap", PassType::Raster, [&](FrameGraphBuilder& b) { b.Read(color); b.SideEffect(); }, noop);
+        graph.AddPass("Decals", PassType::Raster, [&](FrameGraphBuilder& b) { b.Read(color); b.Write(color); }, noop);
+        graph.AddPass("Opaque", PassType::Raster, [&](FrameGraphBuilder& b) { b.Write(color); }, noop);
+        graph.Compile();
+        check("read-modify-write", graph.Describe(), "Opaque -> Decals -> Tonemap");
+    }
+
+    // cycle: reported, the passes in it are not scheduled
+    {
+        FrameGraph graph;
+        FrameGraphResource a = graph.CreateResource("a");
+        FrameGraphResource b = graph.CreateResource("b");
+        graph.AddPass("A", PassType::Raster, [&](FrameGraphBuilder& io) { io.Read(b); io.Write(a); }, noop);
+        graph.AddPass("B", PassType::Raster, [&](FrameGraphBuilder& io) { io.Read(a); io.Write(b); io.SideEffect(); }, noop);
+        graph.Compile();
+        check("cycle", std::to_string(graph.order.size()) + " scheduled", "0 scheduled");
+    }
+
+    std::cout << (passed ? "PASSED" : "FAILED") << std::endl;
+    return passed;
+}
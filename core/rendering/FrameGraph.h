@@ -0,0 +1,88 @@
+#pragma once
+#include <glad/glad.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "GpuTimer.h"
+
+enum class PassType {
+    Raster,
+    Compute // writes are made visible to later readers with glMemoryBarrier
+};
+
+typedef int FrameGraphResource;
+
+// Declares what a pass reads and writes, handed to the setup callback of AddPass()
+class FrameGraphBuilder {
+public:
+    void Read(FrameGraphResource resource) { reads.push_back(resource); }
+    void Write(FrameGraphResource resource) { writes.push_back(resource); }
+    void SideEffect() { sideEffect = true; } // never culled (presents, reads back, ...)
+
+private:
+    friend class FrameGraph;
+    std::vector<FrameGraphResource> reads, writes;
+    bool sideEffect = false;
+};
+
+// Passes declare their resources once, Compile() then
+// - orders them from the reads / writes alone (writers before readers, declaration order
+//   only between passes writing the same resource),
+// - culls passes whose results nobody reads,
+// - works out the first / last user of each resource (realize / release callbacks),
+// - and places memory barriers after compute writes.
+// Execute() runs the compiled schedule every frame and times each pass on the GPU.
+class FrameGraph {
+public:
+    struct PassTiming {
+        std::string name;
+        double milliseconds; // latest finished GPU measurement
+    };
+
+    FrameGraph();
+    ~FrameGraph();
+
+    // realize: before the first pass using the resource, release: after the last one (both optional)
+    // readBarrier: glMemoryBarrier bits needed before reading it after a compute pass wrote it
+    FrameGraphResource CreateResource(const std::string& name, std::function<void()> realize = nullptr,
+        std::function<void()> release = nullptr, GLbitfield readBarrier = 0);
+    void AddPass(const std::string& name, PassType type, std::function<void(FrameGraphBuilder&)> setup, std::function<void()> execute);
+
+    void Compile();
+    void Execute();
+    void Clear(); // drop every pass / resource (before rebuilding)
+
+    bool timingEnabled;
+    const std::vector<PassTiming>& GetTimings() const { return timings; }
+    double GetPassMilliseconds(const std::string& name) const;
+    // Compiled schedule, culled passes marked, for logging
+    std::string Describe() const;
+
+    // Compiles graphs declared out of order and checks the schedule (no GL needed)
+    static bool RunSelfTest();
+
+private:
+    struct Resource {
+        std::string name;
+        std::function<void()> realize, release;
+        GLbitfield readBarrier;
+        int firstPass, lastPass; // compiled order, -1 if unused
+        bool pendingBarrier;
+    };
+    struct Pass {
+        std::string name;
+        PassType type;
+        std::function<void()> execute;
+        FrameGraphBuilder io;
+        bool culled;
+    };
+
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    std::vector<int> order; // compiled pass order (indices into passes)
+    bool compiled;
+
+    std::map<std::string, GpuTimer*> timers;
+    std::vector<PassTiming> timings;
+};
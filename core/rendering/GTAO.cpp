@@ -0,0 +1,78 @@
+#include "GTAO.h"
+#include <glm/gtc/type_ptr.hpp>
+
+GTAO::GTAO(int w, int h)
+    : width(w), height(h), sliceCount(2), stepCount(4), radius(0.5f), historyWeight(0.9f),
+    current(0), frameIndex(0), historyValid(false), prevViewProjection(1.0f) {
+    gtaoShader = new Shader("assets/shaders/gtao.comp");
+    gtaoShader->use();
+    gtaoShader->setInt("gPosition", 0);
+    gtaoShader->setInt("gNormal", 1);
+    gtaoShader->setInt("gDepth", 2);
+    gtaoShader->setInt("history", 3);
+
+    createTextures();
+}
+
+GTAO::~GTAO() {
+    delete gtaoShader;
+    glDeleteTextures(2, historyTextures);
+}
+
+void GTAO::createTextures() {
+    glGenTextures(2, historyTextures);
+    for (int i = 0; i < 2; i++) {
+        glBindTexture(GL_TEXTURE_2D, historyTextures[i]);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RG16F, width, height);
+        // linear: the history is read at reprojected (fractional) positions
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    historyValid = false;
+}
+
+void GTAO::Resize(int w, int h) {
+    width = w;
+    height = h;
+    glDeleteTextures(2, historyTextures);
+    createTextures();
+}
+
+void GTAO::Compute(GBuffer* gBuffer, const glm::mat4& projection, const glm::mat4& view) {
+    // never blend history of another resolution
+    if (gBuffer->width != width || gBuffer->height != height) Resize(gBuffer->width, gBuffer->height);
+
+    // last frame's result becomes the history
+    int previous = current;
+    current = 1 - current;
+
+    gtaoShader->use();
+    gtaoShader->setBool("compactGBuffer", gBuffer->layout == GBufferLayout::Compact);
+    gtaoShader->setMat4("projection", glm::value_ptr(projection));
+    gtaoShader->setMat4("view", glm::value_ptr(view));
+    glm::mat4 invView = glm::inverse(view);
+    gtaoShader->setMat4("invView", glm::value_ptr(invView));
+    gtaoShader->setMat4("prevViewProjection", glm::value_ptr(prevViewProjection));
+
+    gtaoShader->setInt("sliceCount", sliceCount);
+    gtaoShader->setInt("stepCount", stepCount);
+    gtaoShader->setFloat("radius", radius);
+    // 6 slice rotations, then the pattern repeats
+    gtaoShader->setFloat("frameRotation", (float)(frameIndex % 6) / 6.0f);
+    gtaoShader->setFloat("historyWeight", historyValid ? historyWeight : 0.0f);
+
+    glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, gBuffer->gPosition);
+    glActiveTexture(GL_TEXTURE1); glBindTexture(GL_TEXTURE_2D, gBuffer->gNormal);
+    glActiveTexture(GL_TEXTURE2); glBindTexture(GL_TEXTURE_2D, gBuffer->gDepth);
+    glActiveTexture(GL_TEXTURE3); glBindTexture(GL_TEXTURE_2D, historyTextures[previous]);
+    glBindImageTexture(0, historyTextures[current], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
+
+    glDispatchCompute((width + 7) / 8, (height + 7) / 8, 1);
+
+    prevViewProjection = projection * view;
+    historyValid = true;
+    frameIndex++;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "../Shader.h"
+#include "../GBuffer.h"
+
+// Horizon based ground truth AO in one compute pass (gtao.comp), alternative to SSAO.
+// A few slices per pixel per frame, rotated every frame and accumulated over time:
+// the result is reprojected with last frame's view-projection and blended with the history.
+// History textures persist between frames, so they are owned here instead of pooled.
+class GTAO {
+public:
+    unsigned int historyTextures[2]; // RG16F: AO, linear depth (ping-pong)
+    Shader* gtaoShader;
+
+    int width, height;
+    int sliceCount;      // directions per pixel per frame
+    int stepCount;       // taps per direction side
+    float radius;        // view space
+    float historyWeight; // 0 disables temporal accumulation
+
+    GTAO(int w, int h);
+    ~GTAO();
+
+    // Result is sampled by the lighting pass after a texture fetch barrier
+    void Compute(GBuffer* gBuffer, const glm::mat4& projection, const glm::mat4& view);
+
+    unsigned int GetAOTexture() { return historyTextures[current]; }
+    void Resize(int w, int h);
+    void ResetHistory() { historyValid = false; }
+
+private:
+    int current;
+    unsigned int frameIndex;
+    bool historyValid;
+    glm::mat4 prevViewProjection;
+
+    void createTextures();
+};
@@ -0,0 +1,44 @@
+#include "GpuTimer.h"
+
+GpuTimer::GpuTimer() : current(0), lastMs(0.0) {
+    glGenQueries(QUERY_COUNT, queries);
+    for (unsigned int i = 0; i < QUERY_COUNT; i++) pending[i] = false;
+}
+
+GpuTimer::~GpuTimer() {
+    glDeleteQueries(QUERY_COUNT, queries);
+}
+
+void GpuTimer::collect(unsigned int index, bool wait) {
+    if (!pending[index]) return;
+    if (!wait) {
+        GLint available = 0;
+        glGetQueryObjectiv(queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return;
+    }
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &ns);
+    lastMs = ns / 1.0e6;
+    pending[index] = false;
+}
+
+void GpuTimer::Begin() {
+    collect(current, true); // oldest query, normally done long ago
+    glBeginQuery(GL_TIME_ELAPSED, queries[current]);
+}
+
+void GpuTimer::End() {
+    glEndQuery(GL_TIME_ELAPSED);
+    pending[current] = true;
+    current = (current + 1) % QUERY_COUNT;
+
+    // oldest to newest, so lastMs ends on the most recent finished one
+    for (unsigned int i = 0; i < QUERY_COUNT; i++)
+        collect((current + i) % QUERY_COUNT, false);
+}
+
+double GpuTimer::Finish() {
+    for (unsigned int i = 0; i < QUERY_COUNT; i++)
+        collect((current + i) % QUERY_COUNT, true);
+    return lastMs;
+}
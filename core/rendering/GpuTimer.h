@@ -0,0 +1,28 @@
+#pragma once
+#include <glad/glad.h>
+
+// GL_TIME_ELAPSED query ring. Results are picked up a few frames late,
+// so reading them never stalls the CPU (except in Finish()).
+class GpuTimer {
+public:
+    static const unsigned int QUERY_COUNT = 4;
+
+    GpuTimer();
+    ~GpuTimer();
+
+    void Begin();
+    void End();
+
+    // Latest finished measurement
+    double GetMilliseconds() const { return lastMs; }
+    // Waits for every pending query, returns the latest measurement
+    double Finish();
+
+private:
+    unsigned int queries[QUERY_COUNT];
+    bool pending[QUERY_COUNT];
+    unsigned int current;
+    double lastMs;
+
+    void collect(unsigned int index, bool wait);
+};
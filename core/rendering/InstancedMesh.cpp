@@ -1,105 +1,332 @@
 #include "InstancedMesh.h"
 #include <cstddef>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
 
-// 定義標準方塊頂點 (Pos, Normal, UV)
-float instanceCubeVertices[] = {
-    // Back face
-    -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
-     0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  1.0f,
-     0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  0.0f,
-     0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f,  1.0f,
-    -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  0.0f,
-    -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f,  1.0f,
-    // Front face
-    -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f,
-     0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  0.0f,
-     0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  1.0f,
-     0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  1.0f,  1.0f,
-    -0.5f,  0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  1.0f,
-    -0.5f, -0.5f,  0.5f,  0.0f,  0.0f,  1.0f,  0.0f,  0.0f,
-    // Left face
-    -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-    -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  1.0f,
-    -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-    -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-    -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
-    -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-    // Right face
-     0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-     0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-     0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  1.0f,
-     0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  1.0f,
-     0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f,  0.0f,
-     0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f,  0.0f,
-     // Bottom face
-     -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  1.0f,
-      0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  1.0f,
-      0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  0.0f,
-      0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f,  0.0f,
-     -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  0.0f,
-     -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f,  1.0f,
-     // Top face
-     -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f,
-      0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  0.0f,
-      0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  1.0f,
-      0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f,  1.0f,
-     -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  0.0f,
-     -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f,  1.0f
-};
-
-InstancedMesh::InstancedMesh(std::vector<glm::mat4>& models) {
-    this->amount = models.size();
-
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &instanceVBO);
-
-    glBindVertexArray(VAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(instanceCubeVertices), instanceCubeVertices, GL_STATIC_DRAW);
-
-    // Pos (Location 0)
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    // Normal (Location 1)
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    // TexCoord (Location 2)
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-
-    // 2. Instance Matrix (Location 3, 4, 5, 6)
-    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
-    glBufferData(GL_ARRAY_BUFFER, amount * sizeof(glm::mat4), &models[0], GL_STATIC_DRAW);
+glm::mat4 CompactInstance::ToMatrix() const {
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), Position);
+    return glm::scale(model, Scale);
+}
+
+InstancedMesh::InstancedMesh(std::vector<glm::mat4>& models, bool dynamic)
+    : amount((int)models.size()), layout(InstanceLayout::Matrix), instanceStride(sizeof(glm::mat4)), dynamic(dynamic) {
+    init(models.data());
+}
+
+InstancedMesh::InstancedMesh(std::vector<CompactInstance>& instances, bool dynamic)
+    : amount((int)instances.size()), layout(InstanceLayout::Compact), instanceStride(sizeof(CompactInstance)), dynamic(dynamic) {
+    init(instances.data());
+}
+
+void InstancedMesh::SetupInstanceAttributes(InstanceLayout layout) {
+    if (layout == InstanceLayout::Matrix) {
+        // Instance Matrix (Location 3, 4, 5, 6)
+        std::size_t vec4Size = sizeof(glm::vec4);
+
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)0);
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)(1 * vec4Size));
+        glEnableVertexAttribArray(5);
+        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)(2 * vec4Size));
+        glEnableVertexAttribArray(6);
+        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)(3 * vec4Size));
+
+        glVertexAttribDivisor(3, 1);
+        glVertexAttribDivisor(4, 1);
+        glVertexAttribDivisor(5, 1);
+        glVertexAttribDivisor(6, 1);
+    }
+    else {
+        // Compact instance: Position (3), Material (4), Scale (5)
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(CompactInstance), (void*)offsetof(CompactInstance, Position));
+        glEnableVertexAttribArray(4);
+        glVertexAttribIPointer(4, 1, GL_UNSIGNED_INT, sizeof(CompactInstance), (void*)offsetof(CompactInstance, Material));
+        glEnableVertexAttribArray(5);
+        glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(CompactInstance), (void*)offsetof(CompactInstance, Scale));
+
+        glVertexAttribDivisor(3, 1);
+        glVertexAttribDivisor(4, 1);
+        glVertexAttribDivisor(5, 1);
+    }
+}
+
+void InstancedMesh::updateBounds(size_t first, size_t count) {
+    for (size_t i = first; i < first + count; i++) {
+        const unsigned char* data = &instances[i * instanceStride];
+        if (layout == InstanceLayout::Matrix) {
+            // bounds of the unit cube [-0.5, 0.5] under the transform
+            glm::mat4 m;
+            memcpy(&m, data, sizeof(m));
+            glm::vec3 extent;
+            extent.x = 0.5f * (std::fabs(m[0][0]) + std::fabs(m[1][0]) + std::fabs(m[2][0]));
+            extent.y = 0.5f * (std::fabs(m[0][1]) + std::fabs(m[1][1]) + std::fabs(m[2][1]));
+            extent.z = 0.5f * (std::fabs(m[0][2]) + std::fabs(m[1][2]) + std::fabs(m[2][2]));
+            setBounds(i, glm::vec3(m[3]), extent);
+        }
+        else {
+            CompactInstance instance;
+            memcpy(&instance, data, sizeof(instance));
+            setBounds(i, instance.Position, 0.5f * glm::abs(instance.Scale));
+        }
+    }
+}
+
+void InstancedMesh::setBounds(size_t i, const glm::vec3& center, const glm::vec3& extent) {
+    centerX[i] = center.x; centerY[i] = center.y; centerZ[i] = center.z;
+    extentX[i] = extent.x; extentY[i] = extent.y; extentZ[i] = extent.z;
+}
 
-    std::size_t vec4Size = sizeof(glm::vec4);
+void InstancedMesh::init(const void* data) {
+    visibleCount = (unsigned int)amount;
+    culledCount = 0;
+    occludedCount = 0;
+    drawCount = amount;
+    indirect = false;
 
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)0);
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)(1 * vec4Size));
-    glEnableVertexAttribArray(5);
-    glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)(2 * vec4Size));
-    glEnableVertexAttribArray(6);
-    glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, 4 * vec4Size, (void*)(3 * vec4Size));
+    size_t bytes = amount * instanceStride;
+    instances.resize(bytes);
+    if (bytes > 0) memcpy(instances.data(), data, bytes);
+    visibleInstances.reserve(bytes);
 
-    glVertexAttribDivisor(3, 1);
-    glVertexAttribDivisor(4, 1);
-    glVertexAttribDivisor(5, 1);
-    glVertexAttribDivisor(6, 1);
+    // world AABBs
+    size_t padded = (amount + 3) / 4 * 4;
+    centerX.resize(padded); centerY.resize(padded); centerZ.resize(padded);
+    extentX.resize(padded, -1e30f); extentY.resize(padded, -1e30f); extentZ.resize(padded, -1e30f); // padding never passes
+    visibleIndices.resize(padded);
+    updateBounds(0, amount);
+
+    // every ring region starts out empty
+    regionWritten = false;
+    for (unsigned int i = 0; i < PersistentRingBuffer::FRAME_COUNT; i++) {
+        dirtyBegin[i] = 0;
+        dirtyEnd[i] = amount;
+    }
+
+    // 1. Shared indexed cube (packed vertices)
+    mesh = MeshBuffer::CreateCube();
+    indexCount = mesh->indexCount;
+
+    ring = nullptr;
+    if (dynamic) {
+        // regions are a whole number of instances apart, Draw() selects one with baseInstance
+        ring = new PersistentRingBuffer(GL_ARRAY_BUFFER, bytes, instanceStride);
+        instanceVBO = ring->buffer;
+    }
+    else {
+        glGenBuffers(1, &instanceVBO);
+    }
+    mesh->Bind();
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    if (!dynamic) glBufferData(GL_ARRAY_BUFFER, bytes, data, GL_STREAM_DRAW);
+
+    // 2. Instance attributes
+    SetupInstanceAttributes(layout);
 
     glBindVertexArray(0);
+
+    // 3. GPU culling: source transforms + indirect command
+    glGenBuffers(1, &instanceSSBO);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, data, GL_STATIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    DrawElementsIndirectCommand command = { (uint32_t)indexCount, (uint32_t)amount, 0, 0, 0 };
+    glGenBuffers(1, &indirectBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(command), &command, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    cullShader = new Shader("assets/shaders/instance_cull.comp");
+    shaderReloads = Shader::reloads;
+}
+
+void InstancedMesh::resolveCullUniforms() {
+    shaderReloads = Shader::reloads;
+    cullUniforms.planes = cullShader->GetUniform<glm::vec4>(UniformName("planes"));
+    cullUniforms.instanceCount = cullShader->GetUniform<unsigned int>(UniformName("instanceCount"));
+    cullUniforms.instanceStride = cullShader->GetUniform<unsigned int>(UniformName("instanceStride"));
+    cullUniforms.compactLayout = cullShader->GetUniform<bool>(UniformName("compactLayout"));
 }
 
 InstancedMesh::~InstancedMesh() {
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &instanceVBO);
+    if (dynamic) delete ring;
+    else glDeleteBuffers(1, &instanceVBO);
+    glDeleteBuffers(1, &instanceSSBO);
+    glDeleteBuffers(1, &indirectBuffer);
+    delete cullShader;
+    delete mesh;
+}
+
+void InstancedMesh::Cull(const Frustum& frustum, OcclusionCuller* occlusion) {
+    size_t visible = frustum.CullAABBs(centerX.data(), centerY.data(), centerZ.data(),
+        extentX.data(), extentY.data(), extentZ.data(), centerX.size(), visibleIndices.data());
+
+    occludedCount = 0;
+    if (occlusion) {
+        // the frustum survivors are both the occluder candidates and the boxes to test
+        size_t inFrustum = visible;
+        occlusion->RenderOccluders(centerX.data(), centerY.data(), centerZ.data(),
+            extentX.data(), extentY.data(), extentZ.data(), visibleIndices.data(), inFrustum);
+        visible = occlusion->Filter(centerX.data(), centerY.data(), centerZ.data(),
+            extentX.data(), extentY.data(), extentZ.data(), visibleIndices.data(), inFrustum);
+        occludedCount = (unsigned int)(inFrustum - visible);
+    }
+
+    if (dynamic) {
+        // compact straight into this frame's region, it no longer holds the full set afterwards
+        unsigned char* region = ring->Map();
+        for (size_t i = 0; i < visible; i++)
+            memcpy(region + i * instanceStride, &instances[visibleIndices[i] * instanceStride], instanceStride);
+        dirtyBegin[ring->GetFrame()] = 0;
+        dirtyEnd[ring->GetFrame()] = amount;
+        regionWritten = true;
+    }
+    else {
+        visibleInstances.resize(visible * instanceStride);
+        for (size_t i = 0; i < visible; i++)
+            memcpy(&visibleInstances[i * instanceStride], &instances[visibleIndices[i] * instanceStride], instanceStride);
+
+        // orphan + refill, the GPU may still read last frame's instances
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, amount * instanceStride, NULL, GL_STREAM_DRAW);
+        if (visible > 0) glBufferSubData(GL_ARRAY_BUFFER, 0, visible * instanceStride, visibleInstances.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    drawCount = (int)visible;
+    visibleCount = (unsigned int)visible;
+    culledCount = (unsigned int)amount - visibleCount;
+    indirect = false;
+}
+
+void InstancedMesh::CullGPU(const Frustum& frustum) {
+    if (dynamic) {
+        // the compute pass reads the static instance SSBO, dynamic meshes cull on the CPU
+        static bool warned = false;
+        if (!warned) std::cout << "InstancedMesh: GPU culling is not supported for dynamic meshes, using the CPU path" << std::endl;
+        warned = true;
+        Cull(frustum);
+        return;
+    }
+
+    // reset the instance count, the compute pass appends into it
+    DrawElementsIndirectCommand command = { (uint32_t)indexCount, 0, 0, 0, 0 };
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(command), &command);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    // resolved lazily: meshes that never cull on the GPU don't wait for the program to link
+    if (!cullUniforms.planes.IsValid() || shaderReloads != Shader::reloads) resolveCullUniforms();
+    cullUniforms.planes.Set(&frustum.planes[0], 6);
+    cullUniforms.instanceCount.Set((unsigned int)amount);
+    cullUniforms.instanceStride.Set((unsigned int)(instanceStride / sizeof(uint32_t)));
+    cullUniforms.compactLayout.Set(layout == InstanceLayout::Compact);
+    cullShader->use();
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, instanceVBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, indirectBuffer);
+    glDispatchCompute((amount + 63) / 64, 1, 1);
+
+    // instance attributes + draw command are read by the next draw
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    indirect = true;
+    occludedCount = 0;
+}
+
+void InstancedMesh::ReadBackGPUStats() {
+    if (!indirect) return;
+    DrawElementsIndirectCommand command;
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(command), &command);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    visibleCount = command.instanceCount;
+    culledCount = (unsigned int)amount - visibleCount;
+}
+
+unsigned int InstancedMesh::CountVisible(const Frustum& frustum) {
+    return (unsigned int)frustum.CullAABBs(centerX.data(), centerY.data(), centerZ.data(),
+        extentX.data(), extentY.data(), extentZ.data(), centerX.size(), visibleIndices.data());
 }
 
 void InstancedMesh::Draw() {
-    glBindVertexArray(VAO);
-    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, amount);
+    if (dynamic && !regionWritten) syncRegion();
+
+    mesh->Bind();
+    if (dynamic) {
+        GLuint baseInstance = (GLuint)(ring->GetRegionOffset() / instanceStride);
+        if (drawCount > 0)
+            glDrawElementsInstancedBaseInstance(GL_TRIANGLES, indexCount, mesh->indexType, 0, drawCount, baseInstance);
+    }
+    else if (indirect) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, mesh->indexType, 0, 1, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+    else if (drawCount > 0) {
+        glDrawElementsInstanced(GL_TRIANGLES, indexCount, mesh->indexType, 0, drawCount);
+    }
     glBindVertexArray(0);
-}
\ No newline at end of file
+}
+
+void InstancedMesh::UpdateInstances(size_t first, const glm::mat4* models, size_t count) {
+    if (layout != InstanceLayout::Matrix) {
+        std::cout << "InstancedMesh: UpdateInstances(mat4) on a compact-layout mesh!" << std::endl;
+        return;
+    }
+    writeInstances(first, models, count);
+}
+
+void InstancedMesh::UpdateInstances(size_t first, const CompactInstance* data, size_t count) {
+    if (layout != InstanceLayout::Compact) {
+        std::cout << "InstancedMesh: UpdateInstances(CompactInstance) on a matrix-layout mesh!" << std::endl;
+        return;
+    }
+    writeInstances(first, data, count);
+}
+
+void InstancedMesh::writeInstances(size_t first, const void* data, size_t count) {
+    if (!dynamic) {
+        std::cout << "InstancedMesh: UpdateInstances on a static mesh!" << std::endl;
+        return;
+    }
+    if (first >= (size_t)amount) return;
+    count = std::min(count, (size_t)amount - first);
+
+    memcpy(&instances[first * instanceStride], data, count * instanceStride);
+    updateBounds(first, count);
+
+    // every region has to receive the change once
+    for (unsigned int i = 0; i < PersistentRingBuffer::FRAME_COUNT; i++) {
+        dirtyBegin[i] = std::min(dirtyBegin[i], first);
+        dirtyEnd[i] = std::max(dirtyEnd[i], first + count);
+    }
+}
+
+void InstancedMesh::syncRegion() {
+    // copy what changed since this region was last written
+    unsigned int frame = ring->GetFrame();
+    unsigned char* region = ring->Map();
+    if (dirtyBegin[frame] < dirtyEnd[frame])
+        memcpy(region + dirtyBegin[frame] * instanceStride, &instances[dirtyBegin[frame] * instanceStride],
+            (dirtyEnd[frame] - dirtyBegin[frame]) * instanceStride);
+    dirtyBegin[frame] = amount;
+    dirtyEnd[frame] = 0;
+
+    regionWritten = true;
+    drawCount = amount;
+    indirect = false;
+}
+
+void InstancedMesh::EndFrame() {
+    if (!dynamic) return;
+    ring->EndFrame();
+    regionWritten = false;
+}
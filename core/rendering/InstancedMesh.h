@@ -1,15 +1,120 @@
 #pragma once
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <vector>
+#include "../Frustum.h"
+#include "../Shader.h"
+#include "OcclusionCuller.h"
+#include "MeshBuffer.h"
+#include "PersistentRingBuffer.h"
 
+// glMultiDrawElementsIndirect command layout
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+// 32-byte instance for translated + scaled boxes (the city buildings).
+// Attributes: location 3 position, 4 material / seed word (integer), 5 scale.
+struct CompactInstance {
+    glm::vec3 Position;
+    uint32_t Material; // free-form material id / random seed
+    glm::vec3 Scale;
+    float pad;
+
+    glm::mat4 ToMatrix() const;
+};
+
+static_assert(sizeof(CompactInstance) == 32, "CompactInstance must match the 32-byte std430 layout");
+
+enum class InstanceLayout {
+    Matrix,  // mat4 per instance (locations 3-6), any affine transform
+    Compact  // CompactInstance, translation + scale only
+};
+
+// Static meshes upload their instances once; dynamic ones (traffic, drones) keep them in a
+// persistently mapped ring of FRAME_COUNT regions and only copy the ranges that changed.
 class InstancedMesh {
 public:
-    unsigned int VAO, VBO, instanceVBO;
+    MeshBuffer* mesh;
+    unsigned int instanceVBO;    // dynamic: the ring buffer
+    unsigned int instanceSSBO;   // all instances, input of the GPU culling pass
+    unsigned int indirectBuffer; // one DrawElementsIndirectCommand, filled by the GPU culling pass
     int amount; // instance
+    InstanceLayout layout;
+    size_t instanceStride; // bytes per instance
+    int indexCount;
+    bool dynamic;
+    PersistentRingBuffer* ring; // dynamic only
+
+    Shader* cullShader;
 
-    InstancedMesh(std::vector<glm::mat4>& models);
+    // result of the last Cull()
+    unsigned int visibleCount, culledCount;
+    unsigned int occludedCount; // part of culledCount rejected by the occlusion culler
+
+    InstancedMesh(std::vector<glm::mat4>& models, bool dynamic = false);
+    InstancedMesh(std::vector<CompactInstance>& instances, bool dynamic = false);
     ~InstancedMesh();
 
+    // Frustum-cull (and optionally occlusion-cull) the instances and upload only the visible
+    // transforms (compacted). The occlusion culler must have been Begin()'d for this frame.
+    void Cull(const Frustum& frustum, OcclusionCuller* occlusion = nullptr);
+    // Same test in a compute shader: survivors are appended to instanceVBO and counted
+    // into the indirect command, no per-instance CPU work
+    void CullGPU(const Frustum& frustum);
+    // Draws the instances kept by the last Cull() / CullGPU(), or all of them if neither ran
+    // (dynamic: if Cull() did not run this frame)
     void Draw();
-};
\ No newline at end of file
+
+    // Dynamic only: replace instances [first, first + count), the layout must match
+    void UpdateInstances(size_t first, const glm::mat4* models, size_t count);
+    void UpdateInstances(size_t first, const CompactInstance* data, size_t count);
+    // Dynamic only: call after the frame's last Draw(), fences the region and moves to the next one
+    void EndFrame();
+
+    // Reads back the GPU pass result into visibleCount / culledCount (stalls, debug only)
+    void ReadBackGPUStats();
+    // CPU reference of the GPU pass: visible count for the same frustum
+    unsigned int CountVisible(const Frustum& frustum);
+
+    size_t GetInstanceBufferSize() const { return amount * instanceStride; }
+
+    // Instance attributes (location 3+) for the bound VAO, sourced from the bound GL_ARRAY_BUFFER
+    static void SetupInstanceAttributes(InstanceLayout layout);
+
+private:
+    std::vector<unsigned char> instances; // amount * instanceStride bytes
+    // world AABBs in SoA layout (center / half extent), padded to a multiple of 4
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+
+    std::vector<uint32_t> visibleIndices;
+    std::vector<unsigned char> visibleInstances;
+    int drawCount;
+    bool indirect; // last cull ran on the GPU
+
+    // cullShader uniforms, resolved on the first CullGPU() and after shader reloads
+    struct CullUniforms {
+        UniformHandle<glm::vec4> planes;
+        UniformHandle<unsigned int> instanceCount, instanceStride;
+        UniformHandle<bool> compactLayout;
+    };
+    CullUniforms cullUniforms;
+    unsigned int shaderReloads; // Shader::reloads the handles were resolved at
+
+    // dynamic: instances changed since each ring region was last written, [begin, end)
+    size_t dirtyBegin[PersistentRingBuffer::FRAME_COUNT], dirtyEnd[PersistentRingBuffer::FRAME_COUNT];
+    bool regionWritten; // current region already filled this frame
+
+    void init(const void* data);
+    void updateBounds(size_t first, size_t count);
+    void setBounds(size_t i, const glm::vec3& center, const glm::vec3& extent);
+    void writeInstances(size_t first, const void* data, size_t count);
+    void syncRegion();
+    void resolveCullUniforms();
+};
@@ -0,0 +1,38 @@
+#include "LightBuffer.h"
+#include <cstring>
+#include <iostream>
+
+LightBuffer::LightBuffer(unsigned int maxLights) : capacity(maxLights), count(0) {
+    // glBindBufferRange offsets must respect the SSBO alignment
+    GLint alignment = 256;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    ring = new PersistentRingBuffer(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)capacity * sizeof(PointLight), alignment);
+    ssbo = ring->buffer;
+}
+
+LightBuffer::~LightBuffer() {
+    delete ring;
+}
+
+PointLight* LightBuffer::Map() {
+    return (PointLight*)ring->Map();
+}
+
+void LightBuffer::Write(const std::vector<PointLight>& lights) {
+    count = (unsigned int)lights.size();
+    if (count > capacity) {
+        static bool warned = false;
+        if (!warned) std::cout << "LightBuffer: " << count << " lights, only " << capacity << " fit!" << std::endl;
+        warned = true;
+        count = capacity;
+    }
+    memcpy(Map(), lights.data(), count * sizeof(PointLight));
+}
+
+void LightBuffer::Bind(unsigned int binding) {
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, binding, ssbo, ring->GetRegionOffset(), ring->regionSize);
+}
+
+void LightBuffer::EndFrame() {
+    ring->EndFrame();
+}
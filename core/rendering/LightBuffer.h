@@ -0,0 +1,31 @@
+#pragma once
+#include <glad/glad.h>
+#include <vector>
+#include "PointLight.h"
+#include "PersistentRingBuffer.h"
+
+// Light SSBO (std430), a persistently mapped ring of FRAME_COUNT regions.
+// The CPU writes frame N into one region while the GPU still reads N-1 / N-2.
+class LightBuffer {
+public:
+    static const unsigned int FRAME_COUNT = PersistentRingBuffer::FRAME_COUNT;
+
+    unsigned int ssbo;
+    unsigned int capacity;  // max lights per frame
+    unsigned int count;     // lights written this frame
+
+    LightBuffer(unsigned int maxLights);
+    ~LightBuffer();
+
+    // Wait for the current region and return its write pointer (capacity entries)
+    PointLight* Map();
+    // Copy lights into the current region (clamped to capacity)
+    void Write(const std::vector<PointLight>& lights);
+
+    void Bind(unsigned int binding);
+    // Call once the frame's draws are submitted, then move on to the next region
+    void EndFrame();
+
+private:
+    PersistentRingBuffer* ring;
+};
@@ -0,0 +1,107 @@
+#include "LightClusters.h"
+#include <algorithm>
+#include <cmath>
+
+// min / max of v / d for d in [a, b] (a, b > 0)
+static float minOverDepth(float v, float a, float b) { return v < 0.0f ? v / a : v / b; }
+static float maxOverDepth(float v, float a, float b) { return v > 0.0f ? v / a : v / b; }
+
+static int toTile(float ndc, unsigned int grid) {
+    int t = (int)std::floor((ndc * 0.5f + 0.5f) * (float)grid);
+    return std::min(std::max(t, 0), (int)grid - 1);
+}
+
+LightClusters::LightClusters(unsigned int x, unsigned int y, unsigned int z)
+    : gridX(x), gridY(y), gridZ(z), zNear(0.1f), zFar(100.0f), tanHalfY(1.0f), tanHalfX(1.0f) {
+}
+
+unsigned int LightClusters::GetSlice(float depth) const {
+    if (depth <= zNear) return 0;
+    float s = std::log(depth / zNear) / std::log(zFar / zNear) * (float)gridZ;
+    return std::min((unsigned int)s, gridZ - 1);
+}
+
+float LightClusters::GetSliceNear(unsigned int slice) const {
+    return zNear * std::pow(zFar / zNear, (float)slice / (float)gridZ);
+}
+
+template <typename Fn>
+void LightClusters::forEachCluster(const glm::vec3& viewPos, float radius, Fn fn) const {
+    float depth = -viewPos.z;
+    if (depth + radius < zNear || depth - radius > zFar) return;
+
+    float dMin = std::max(depth - radius, zNear);
+    float dMax = std::min(depth + radius, zFar);
+    unsigned int s0 = GetSlice(dMin);
+    unsigned int s1 = GetSlice(dMax);
+
+    for (unsigned int z = s0; z <= s1; z++) {
+        // part of the light's depth range inside this slice
+        float a = std::max(dMin, GetSliceNear(z));
+        float b = std::min(dMax, GetSliceFar(z));
+        if (a > b) a = b;
+
+        // project the view-space AABB of the sphere, conservative over [a, b]
+        float x0 = minOverDepth(viewPos.x - radius, a, b) / tanHalfX;
+        float x1 = maxOverDepth(viewPos.x + radius, a, b) / tanHalfX;
+        float y0 = minOverDepth(viewPos.y - radius, a, b) / tanHalfY;
+        float y1 = maxOverDepth(viewPos.y + radius, a, b) / tanHalfY;
+        if (x1 < -1.0f || x0 > 1.0f || y1 < -1.0f || y0 > 1.0f) continue;
+
+        int tx0 = toTile(x0, gridX), tx1 = toTile(x1, gridX);
+        int ty0 = toTile(y0, gridY), ty1 = toTile(y1, gridY);
+        for (int y = ty0; y <= ty1; y++)
+            for (int x = tx0; x <= tx1; x++)
+                fn(GetClusterIndex(x, y, z));
+    }
+}
+
+void LightClusters::setFrustum(float fovY, float aspect, float zNear, float zFar) {
+    this->zNear = zNear;
+    this->zFar = zFar;
+    tanHalfY = std::tan(fovY * 0.5f);
+    tanHalfX = tanHalfY * aspect;
+}
+
+void LightClusters::Build(const PointLight* lights, size_t lightCount, const glm::mat4& view,
+    float fovY, float aspect, float zNear, float zFar) {
+    setFrustum(fovY, aspect, zNear, zFar);
+
+    viewSpheres.resize(lightCount);
+    for (size_t i = 0; i < lightCount; i++)
+        viewSpheres[i] = glm::vec4(glm::vec3(view * glm::vec4(lights[i].Position, 1.0f)), lights[i].Radius);
+    bin();
+}
+
+void LightClusters::Build(const float* posX, const float* posY, const float* posZ, const float* radius, size_t lightCount,
+    const glm::mat4& view, float fovY, float aspect, float zNear, float zFar) {
+    setFrustum(fovY, aspect, zNear, zFar);
+
+    viewSpheres.resize(lightCount);
+    for (size_t i = 0; i < lightCount; i++)
+        viewSpheres[i] = glm::vec4(glm::vec3(view * glm::vec4(posX[i], posY[i], posZ[i], 1.0f)), radius[i]);
+    bin();
+}
+
+void LightClusters::bin() {
+    unsigned int count = GetClusterCount();
+    clusters.assign(count, ClusterRange{ 0, 0 });
+
+    // 1. count lights per cluster
+    for (size_t i = 0; i < viewSpheres.size(); i++)
+        forEachCluster(glm::vec3(viewSpheres[i]), viewSpheres[i].w, [&](unsigned int c) { clusters[c].count++; });
+
+    // 2. prefix sum -> offsets
+    uint32_t total = 0;
+    for (unsigned int c = 0; c < count; c++) {
+        clusters[c].offset = total;
+        total += clusters[c].count;
+    }
+
+    // 3. fill index list (lights stay sorted by index inside each cluster)
+    lightIndices.resize(total);
+    cursor.resize(count);
+    for (unsigned int c = 0; c < count; c++) cursor[c] = clusters[c].offset;
+    for (size_t i = 0; i < viewSpheres.size(); i++)
+        forEachCluster(glm::vec3(viewSpheres[i]), viewSpheres[i].w, [&](unsigned int c) { lightIndices[cursor[c]++] = (uint32_t)i; });
+}
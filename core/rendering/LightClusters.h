@@ -0,0 +1,58 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "PointLight.h"
+
+// One entry per cluster: a range inside the light index list
+struct ClusterRange {
+    uint32_t offset;
+    uint32_t count;
+};
+
+// Bins point lights into view-frustum clusters (froxels).
+// X/Y split the screen into tiles, Z uses exponential slices between zNear and zFar.
+// Pure CPU code, no GL calls, so it can run (and be tested) without a context.
+class LightClusters {
+public:
+    unsigned int gridX, gridY, gridZ;
+
+    LightClusters(unsigned int x = 16, unsigned int y = 9, unsigned int z = 24);
+
+    // Rebuild the cluster lists for this frame
+    void Build(const PointLight* lights, size_t lightCount, const glm::mat4& view,
+        float fovY, float aspect, float zNear, float zFar);
+    // Same, from structure-of-arrays positions (LightSystem)
+    void Build(const float* posX, const float* posY, const float* posZ, const float* radius, size_t lightCount,
+        const glm::mat4& view, float fovY, float aspect, float zNear, float zFar);
+
+    unsigned int GetClusterCount() const { return gridX * gridY * gridZ; }
+    unsigned int GetClusterIndex(unsigned int x, unsigned int y, unsigned int z) const {
+        return x + gridX * (y + gridY * z);
+    }
+
+    // View-space depth (positive, in front of the camera) -> Z slice
+    unsigned int GetSlice(float depth) const;
+    // Near / far depth of a Z slice
+    float GetSliceNear(unsigned int slice) const;
+    float GetSliceFar(unsigned int slice) const { return GetSliceNear(slice + 1); }
+
+    const std::vector<ClusterRange>& GetClusters() const { return clusters; }
+    const std::vector<uint32_t>& GetLightIndices() const { return lightIndices; }
+
+private:
+    std::vector<ClusterRange> clusters;
+    std::vector<uint32_t> lightIndices;
+    std::vector<uint32_t> cursor; // write position per cluster while filling
+    std::vector<glm::vec4> viewSpheres; // view-space center + radius
+
+    float zNear, zFar;
+    float tanHalfY, tanHalfX;
+
+    void setFrustum(float fovY, float aspect, float zNear, float zFar);
+    void bin();
+
+    // Visits every cluster touched by the light's bounding box
+    template <typename Fn>
+    void forEachCluster(const glm::vec3& viewPos, float radius, Fn fn) const;
+};
@@ -0,0 +1,27 @@
+#include "LightProxyRenderer.h"
+#include "Primitives.h"
+#include <glm/gtc/type_ptr.hpp>
+
+LightProxyRenderer::LightProxyRenderer(float size, float maxDistance) : size(size), maxDistance(maxDistance) {
+    shader = new Shader("assets/shaders/light_box.vert", "assets/shaders/light_box.frag");
+}
+
+LightProxyRenderer::~LightProxyRenderer() {
+    delete shader;
+}
+
+void LightProxyRenderer::Draw(unsigned int lightCount, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos) {
+    if (lightCount == 0) return;
+
+    Frustum frustum(projection * view);
+
+    shader->use();
+    shader->setMat4("projection", glm::value_ptr(projection));
+    shader->setMat4("view", glm::value_ptr(view));
+    shader->setVec3("viewPos", viewPos);
+    shader->setFloat("proxySize", size);
+    shader->setFloat("maxDistance", maxDistance);
+    shader->setVec4Array("frustumPlanes", frustum.planes, 6);
+
+    Primitives::renderCube((int)lightCount);
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "../Shader.h"
+#include "../Frustum.h"
+
+// Glowing boxes marking the point lights, all drawn with one instanced draw.
+// Position / color come straight from the light SSBO (LIGHT_SSBO_BINDING);
+// proxies outside the frustum or beyond maxDistance collapse to a degenerate
+// point in the vertex shader, so nothing is read back or rebuilt on the CPU.
+class LightProxyRenderer {
+public:
+    Shader* shader;
+    float size;        // edge length of a proxy box
+    float maxDistance; // proxies farther from the camera are skipped
+
+    LightProxyRenderer(float size = 0.1f, float maxDistance = 60.0f);
+    ~LightProxyRenderer();
+
+    // Light SSBO must be bound, draws into the current framebuffer
+    void Draw(unsigned int lightCount, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos);
+};
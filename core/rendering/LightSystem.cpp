@@ -0,0 +1,167 @@
+#include "LightSystem.h"
+#include "../SimdMath.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+static const double TWO_PI = 6.283185307179586;
+
+static float wrapAngle(double x) {
+    return (float)(x - std::floor(x / TWO_PI) * TWO_PI);
+}
+
+LightSystem::LightSystem(ThreadPool* pool)
+    : orbitRadius(40.0f), baseHeight(4.0f), bobHeight(2.0f), pool(pool), count(0) {
+}
+
+void LightSystem::Add(const glm::vec3& color, float radius, float linear, float quadratic) {
+    unsigned int i = count++;
+    size_t padded = (count + LANE_PAD - 1) / LANE_PAD * LANE_PAD;
+    if (posX.size() < padded) {
+        for (std::vector<float>* v : { &posX, &posY, &posZ, &colorR, &colorG, &colorB,
+                                       &this->radius, &this->linear, &this->quadratic, &phase, &bobPhase })
+            v->resize(padded, 0.0f);
+    }
+
+    colorR[i] = color.r; colorG[i] = color.g; colorB[i] = color.b;
+    this->radius[i] = radius;
+    this->linear[i] = linear;
+    this->quadratic[i] = quadratic;
+
+    // same phases as the old loop (offset = i * 10, height offset = i), wrapped once here
+    phase[i] = wrapAngle(i * 10.0);
+    bobPhase[i] = wrapAngle((double)i);
+}
+
+void LightSystem::updateRange(size_t begin, size_t end, float a, float b, float c, PointLight* gpuLights, unsigned int gpuCapacity) {
+    size_t i = begin;
+
+#if defined(SIMD_HAS_AVX2)
+    __m256 a8 = _mm256_set1_ps(a), b8 = _mm256_set1_ps(b), c8 = _mm256_set1_ps(c);
+    __m256 r8 = _mm256_set1_ps(orbitRadius), base8 = _mm256_set1_ps(baseHeight), bob8 = _mm256_set1_ps(bobHeight);
+    for (; i + 8 <= end; i += 8) {
+        __m256 p = _mm256_loadu_ps(&phase[i]);
+        __m256 s0, c0, s1, c1, s2, c2;
+        simd::sincos8(_mm256_add_ps(a8, p), s0, c0);
+        simd::sincos8(_mm256_add_ps(b8, p), s1, c1);
+        simd::sincos8(_mm256_add_ps(c8, _mm256_loadu_ps(&bobPhase[i])), s2, c2);
+        _mm256_storeu_ps(&posX[i], _mm256_mul_ps(s0, r8));
+        _mm256_storeu_ps(&posZ[i], _mm256_mul_ps(c1, r8));
+        _mm256_storeu_ps(&posY[i], _mm256_add_ps(base8, _mm256_mul_ps(s2, bob8)));
+    }
+#endif
+    __m128 a4 = _mm_set1_ps(a), b4 = _mm_set1_ps(b), c4 = _mm_set1_ps(c);
+    __m128 r4 = _mm_set1_ps(orbitRadius), base4 = _mm_set1_ps(baseHeight), bob4 = _mm_set1_ps(bobHeight);
+    for (; i + 4 <= end; i += 4) {
+        __m128 p = _mm_loadu_ps(&phase[i]);
+        __m128 s0, c0, s1, c1, s2, c2;
+        simd::sincos4(_mm_add_ps(a4, p), s0, c0);
+        simd::sincos4(_mm_add_ps(b4, p), s1, c1);
+        simd::sincos4(_mm_add_ps(c4, _mm_loadu_ps(&bobPhase[i])), s2, c2);
+        _mm_storeu_ps(&posX[i], _mm_mul_ps(s0, r4));
+        _mm_storeu_ps(&posZ[i], _mm_mul_ps(c1, r4));
+        _mm_storeu_ps(&posY[i], _mm_add_ps(base4, _mm_mul_ps(s2, bob4)));
+    }
+
+    if (gpuLights == nullptr) return;
+
+    // AoS write into the (write-combined) mapped buffer, whole structs in order
+    size_t last = std::min<size_t>(std::min<size_t>(end, count), gpuCapacity);
+    for (size_t j = begin; j < last; j++) {
+        PointLight light;
+        light.Position = glm::vec3(posX[j], posY[j], posZ[j]);
+        light.Radius = radius[j];
+        light.Color = glm::vec3(colorR[j], colorG[j], colorB[j]);
+        light.Linear = linear[j];
+        light.Quadratic = quadratic[j];
+        light.pad[0] = light.pad[1] = light.pad[2] = 0.0f;
+        gpuLights[j] = light;
+    }
+}
+
+void LightSystem::Update(float time, PointLight* gpuLights, unsigned int gpuCapacity) {
+    // shared angles, wrapped in double so the SIMD arguments stay small
+    float a = wrapAngle(time * 0.3);
+    float b = wrapAngle(time * 0.15);
+    float c = wrapAngle(time * 0.6);
+
+    size_t padded = posX.size();
+    if (pool == nullptr) {
+        updateRange(0, padded, a, b, c, gpuLights, gpuCapacity);
+        return;
+    }
+    // ParallelFor also runs chunks on the calling thread
+    pool->ParallelFor(padded, CHUNK_SIZE, [&](size_t begin, size_t end) {
+        updateRange(begin, end, a, b, c, gpuLights, gpuCapacity);
+    });
+}
+
+void LightSystem::UpdateScalar(float time, PointLight* gpuLights, unsigned int gpuCapacity) {
+    for (unsigned int i = 0; i < count; i++) {
+        float t = time * 0.3f;
+        float offset = i * 10.0f;
+
+        float x = sin(t + offset) * orbitRadius;
+        float z = cos(t * 0.5f + offset) * orbitRadius;
+        float y = baseHeight + sin(t * 2.0f + i) * bobHeight;
+
+        posX[i] = x; posY[i] = y; posZ[i] = z;
+        if (gpuLights != nullptr && i < gpuCapacity) {
+            gpuLights[i].Position = glm::vec3(x, y, z);
+            gpuLights[i].Radius = radius[i];
+            gpuLights[i].Color = glm::vec3(colorR[i], colorG[i], colorB[i]);
+            gpuLights[i].Linear = linear[i];
+            gpuLights[i].Quadratic = quadratic[i];
+        }
+    }
+}
+
+void LightSystem::RunBenchmark(unsigned int lightCount, unsigned int iterations) {
+    ThreadPool workers;
+    LightSystem serial(nullptr); // a pool of one worker would still run on 2 threads
+    LightSystem threaded(&workers);
+    for (unsigned int i = 0; i < lightCount; i++) {
+        serial.Add(glm::vec3(1.0f));
+        threaded.Add(glm::vec3(1.0f));
+    }
+    std::vector<PointLight> upload(lightCount);
+
+    auto measure = [&](const char* name, auto update) {
+        update(0.0f); // warm up
+        auto start = std::chrono::high_resolution_clock::now();
+        for (unsigned int n = 0; n < iterations; n++) update(n * 0.016f);
+        auto stop = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(stop - start).count() / iterations;
+        std::cout << "  " << name << ": " << ms << " ms / update" << std::endl;
+        return ms;
+    };
+
+    std::cout << "Light animation benchmark, " << lightCount << " lights, " << iterations << " iterations" << std::endl;
+    double scalar = measure("scalar (old loop)", [&](float t) { serial.UpdateScalar(t, upload.data(), lightCount); });
+#if defined(SIMD_HAS_AVX2)
+    const char* simdName = "SIMD (AVX2), 1 thread";
+#else
+    const char* simdName = "SIMD (SSE2), 1 thread";
+#endif
+    double simd1 = measure(simdName, [&](float t) { serial.Update(t, upload.data(), lightCount); });
+    double simdN = measure("SIMD + thread pool", [&](float t) { threaded.Update(t, upload.data(), lightCount); });
+    std::cout << "  speedup: " << scalar / simd1 << "x (1 thread), " << scalar / simdN << "x ("
+              << workers.GetThreadCount() + 1 << " threads)" << std::endl;
+
+    // accuracy against a double precision reference (the float scalar loop drifts for large i)
+    const float t = 123.4f;
+    serial.Update(t, nullptr, 0);
+    std::vector<float> simdX = serial.posX, simdY = serial.posY, simdZ = serial.posZ;
+    serial.UpdateScalar(t, nullptr, 0);
+    float simdError = 0.0f, scalarError = 0.0f;
+    for (unsigned int i = 0; i < lightCount; i++) {
+        double tt = t * 0.3;
+        double x = std::sin(tt + i * 10.0) * serial.orbitRadius;
+        double z = std::cos(tt * 0.5 + i * 10.0) * serial.orbitRadius;
+        double y = serial.baseHeight + std::sin(tt * 2.0 + i) * serial.bobHeight;
+        simdError = std::max(simdError, (float)std::max({ std::abs(x - simdX[i]), std::abs(y - simdY[i]), std::abs(z - simdZ[i]) }));
+        scalarError = std::max(scalarError, (float)std::max({ std::abs(x - serial.posX[i]), std::abs(y - serial.posY[i]), std::abs(z - serial.posZ[i]) }));
+    }
+    std::cout << "  max position error: SIMD " << simdError << ", scalar " << scalarError << std::endl;
+}
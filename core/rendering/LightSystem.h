@@ -0,0 +1,45 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include "PointLight.h"
+#include "../ThreadPool.h"
+
+// Animated neon lights in structure-of-arrays layout.
+// Update() runs the orbit animation 4/8 lights at a time (SSE2/AVX2 sincos),
+// split across the thread pool, and writes the GPU structs straight into the
+// mapped light buffer.
+class LightSystem {
+public:
+    // SoA data, padded to a multiple of LANE_PAD so the SIMD loop has no tail
+    std::vector<float> posX, posY, posZ;
+    std::vector<float> colorR, colorG, colorB;
+    std::vector<float> radius, linear, quadratic;
+    std::vector<float> phase;     // orbit phase (wrapped to [0, 2pi))
+    std::vector<float> bobPhase;  // height phase (wrapped to [0, 2pi))
+
+    float orbitRadius, baseHeight, bobHeight;
+
+    LightSystem(ThreadPool* pool); // null: Update() runs on the calling thread only
+
+    void Add(const glm::vec3& color, float radius = 15.0f, float linear = 0.14f, float quadratic = 0.07f);
+    unsigned int GetCount() const { return count; }
+    glm::vec3 GetPosition(unsigned int i) const { return glm::vec3(posX[i], posY[i], posZ[i]); }
+    glm::vec3 GetColor(unsigned int i) const { return glm::vec3(colorR[i], colorG[i], colorB[i]); }
+
+    // Animate to `time` (seconds). gpuLights may be null, at most `gpuCapacity` entries are written.
+    void Update(float time, PointLight* gpuLights, unsigned int gpuCapacity);
+    // Reference path: the original per-light scalar loop, single threaded
+    void UpdateScalar(float time, PointLight* gpuLights, unsigned int gpuCapacity);
+
+    // Prints scalar vs SIMD vs SIMD + threads timings (no GL needed)
+    static void RunBenchmark(unsigned int lightCount, unsigned int iterations);
+
+private:
+    static const unsigned int LANE_PAD = 8;
+    static const unsigned int CHUNK_SIZE = 4096;
+
+    ThreadPool* pool;
+    unsigned int count;
+
+    void updateRange(size_t begin, size_t end, float a, float b, float c, PointLight* gpuLights, unsigned int gpuCapacity);
+};
@@ -0,0 +1,129 @@
+#include "MeshBuffer.h"
+#include <glm/gtc/packing.hpp>
+#include <cmath>
+#include <cstddef>
+
+static float signNotZero(float v) { return v >= 0.0f ? 1.0f : -1.0f; }
+
+// unit vector -> octahedron -> unfolded square [-1, 1]^2
+static glm::vec2 octEncode(glm::vec3 n) {
+    n /= (std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z));
+    glm::vec2 e(n.x, n.y);
+    if (n.z < 0.0f)
+        e = glm::vec2((1.0f - std::fabs(n.y)) * signNotZero(n.x), (1.0f - std::fabs(n.x)) * signNotZero(n.y));
+    return e;
+}
+
+static int16_t toSnorm16(float v) {
+    return (int16_t)std::round(glm::clamp(v, -1.0f, 1.0f) * 32767.0f);
+}
+
+PackedVertex MeshBuffer::Pack(const Vertex& vertex) {
+    PackedVertex packed;
+    packed.position[0] = glm::packHalf1x16(vertex.Position.x);
+    packed.position[1] = glm::packHalf1x16(vertex.Position.y);
+    packed.position[2] = glm::packHalf1x16(vertex.Position.z);
+    packed.position[3] = glm::packHalf1x16(1.0f);
+
+    glm::vec2 oct = octEncode(vertex.Normal);
+    packed.normal[0] = toSnorm16(oct.x);
+    packed.normal[1] = toSnorm16(oct.y);
+
+    packed.uv[0] = glm::packHalf1x16(vertex.TexCoords.x);
+    packed.uv[1] = glm::packHalf1x16(vertex.TexCoords.y);
+    return packed;
+}
+
+glm::vec3 MeshBuffer::UnpackNormal(const int16_t normal[2]) {
+    // same as OctDecode() in the shaders
+    glm::vec2 e(std::max(normal[0] / 32767.0f, -1.0f), std::max(normal[1] / 32767.0f, -1.0f));
+    glm::vec3 n(e.x, e.y, 1.0f - std::fabs(e.x) - std::fabs(e.y));
+    if (n.z < 0.0f) {
+        float x = n.x;
+        n.x = (1.0f - std::fabs(n.y)) * signNotZero(x);
+        n.y = (1.0f - std::fabs(x)) * signNotZero(n.y);
+    }
+    return glm::normalize(n);
+}
+
+MeshBuffer::MeshBuffer(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+    : vertexCount((int)vertices.size()), indexCount((int)indices.size()) {
+    std::vector<PackedVertex> packed(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) packed[i] = Pack(vertices[i]);
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
+
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex), packed.data(), GL_STATIC_DRAW);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    if (vertices.size() <= 65536) {
+        std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(uint16_t), shortIndices.data(), GL_STATIC_DRAW);
+        indexType = GL_UNSIGNED_SHORT;
+    }
+    else {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        indexType = GL_UNSIGNED_INT;
+    }
+
+    // Pos (Location 0)
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+    // Octahedral normal (Location 1)
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+    // TexCoord (Location 2)
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, uv));
+
+    glBindVertexArray(0);
+}
+
+MeshBuffer::~MeshBuffer() {
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+}
+
+MeshBuffer* MeshBuffer::CreateCube() {
+    // corner i: x/y/z sign from bits 0/1/2, faces counter-clockwise seen from outside
+    static const int faces[6][4] = {
+        { 1, 3, 7, 5 }, { 0, 4, 6, 2 }, // +x, -x
+        { 2, 6, 7, 3 }, { 0, 1, 5, 4 }, // +y, -y
+        { 4, 5, 7, 6 }, { 0, 2, 3, 1 }  // +z, -z
+    };
+    static const glm::vec3 normals[6] = {
+        glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+    };
+    static const glm::vec2 uvs[4] = { glm::vec2(0.0f, 0.0f), glm::vec2(1.0f, 0.0f), glm::vec2(1.0f, 1.0f), glm::vec2(0.0f, 1.0f) };
+
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    for (int f = 0; f < 6; f++) {
+        unsigned int base = (unsigned int)vertices.size();
+        for (int v = 0; v < 4; v++) {
+            int c = faces[f][v];
+            glm::vec3 position((c & 1) ? 0.5f : -0.5f, (c & 2) ? 0.5f : -0.5f, (c & 4) ? 0.5f : -0.5f);
+            vertices.push_back({ position, normals[f], uvs[v] });
+        }
+        unsigned int quad[6] = { 0, 1, 2, 0, 2, 3 };
+        for (unsigned int i : quad) indices.push_back(base + i);
+    }
+    return new MeshBuffer(vertices, indices);
+}
+
+void MeshBuffer::Bind() {
+    glBindVertexArray(VAO);
+}
+
+void MeshBuffer::Draw(int instances) {
+    glBindVertexArray(VAO);
+    glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, 0, instances);
+    glBindVertexArray(0);
+}
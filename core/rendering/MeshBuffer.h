@@ -0,0 +1,45 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// Full precision vertex, what mesh generators / loaders fill in
+struct Vertex {
+    glm::vec3 Position;
+    glm::vec3 Normal;
+    glm::vec2 TexCoords;
+};
+
+// GPU vertex (16 bytes):
+// location 0: half-float position (w unused), location 1: octahedral normal (snorm16 x2),
+// location 2: half-float uv. Decode the normal with OctDecode() in the vertex shader.
+struct PackedVertex {
+    uint16_t position[4];
+    int16_t normal[2];
+    uint16_t uv[2];
+};
+
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay 16 bytes");
+
+// Indexed, packed static mesh (VAO + vertex / index buffers).
+// Indices are 16 bit when the vertex count allows it.
+class MeshBuffer {
+public:
+    unsigned int VAO, VBO, EBO;
+    int vertexCount, indexCount;
+    GLenum indexType; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+
+    MeshBuffer(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
+    ~MeshBuffer();
+
+    // Unit cube [-0.5, 0.5], 24 vertices / 36 indices, counter-clockwise faces
+    static MeshBuffer* CreateCube();
+
+    static PackedVertex Pack(const Vertex& vertex);
+    static glm::vec3 UnpackNormal(const int16_t normal[2]);
+
+    // VAO stays bound afterwards, e.g. to add instance attributes (location 3+)
+    void Bind();
+    void Draw(int instances = 1);
+};
@@ -0,0 +1,326 @@
+#include "OcclusionCuller.h"
+#include "../Frustum.h"
+#include "../SimdMath.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+static const float MIN_W = 1e-4f;
+static const int BAND_HEIGHT = 16;
+
+// box corner i: x/y/z sign from bits 0/1/2
+static glm::vec3 boxCorner(const glm::vec3& center, const glm::vec3& extent, int i) {
+    return center + glm::vec3((i & 1) ? extent.x : -extent.x, (i & 2) ? extent.y : -extent.y, (i & 4) ? extent.z : -extent.z);
+}
+
+// box faces, counter-clockwise seen from outside
+static const int BOX_FACES[6][4] = {
+    { 1, 3, 7, 5 }, { 0, 4, 6, 2 }, // +x, -x
+    { 2, 6, 7, 3 }, { 0, 1, 5, 4 }, // +y, -y
+    { 4, 5, 7, 6 }, { 0, 2, 3, 1 }  // +z, -z
+};
+
+// corners -> screen x / y (pixels, y up) and 1/w, false if the box reaches behind the camera
+static bool projectBox(const glm::mat4& viewProjection, const glm::vec3& center, const glm::vec3& extent,
+    int width, int height, float* sx, float* sy, float* invW) {
+    for (int i = 0; i < 8; i++) {
+        glm::vec4 clip = viewProjection * glm::vec4(boxCorner(center, extent, i), 1.0f);
+        if (clip.w <= MIN_W) return false;
+        invW[i] = 1.0f / clip.w;
+        sx[i] = (clip.x * invW[i] * 0.5f + 0.5f) * (float)width;
+        sy[i] = (clip.y * invW[i] * 0.5f + 0.5f) * (float)height;
+    }
+    return true;
+}
+
+OcclusionCuller::OcclusionCuller(ThreadPool* pool, int width, int height, unsigned int maxOccluders)
+    : width((width + 3) / 4 * 4), height(height), maxOccluders(maxOccluders), pool(pool), viewProjection(1.0f) {
+    depth.assign((size_t)this->width * this->height, 0.0f);
+}
+
+void OcclusionCuller::Begin(const glm::mat4& viewProjection) {
+    this->viewProjection = viewProjection;
+    std::fill(depth.begin(), depth.end(), 0.0f);
+}
+
+void OcclusionCuller::setupBox(const glm::vec3& center, const glm::vec3& extent) {
+    float sx[8], sy[8], iw[8];
+    if (!projectBox(viewProjection, center, extent, width, height, sx, sy, iw)) return;
+
+    for (int f = 0; f < 6; f++) {
+        for (int t = 0; t < 2; t++) {
+            int v[3] = { BOX_FACES[f][0], BOX_FACES[f][t + 1], BOX_FACES[f][t + 2] };
+            float x0 = sx[v[0]], y0 = sy[v[0]], x1 = sx[v[1]], y1 = sy[v[1]], x2 = sx[v[2]], y2 = sy[v[2]];
+            float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+            if (area <= 0.0f) continue; // back facing
+
+            Triangle tri;
+            tri.minX = std::max(0, (int)std::floor(std::min({ x0, x1, x2 })));
+            tri.maxX = std::min(width - 1, (int)std::ceil(std::max({ x0, x1, x2 })) - 1);
+            tri.minY = std::max(0, (int)std::floor(std::min({ y0, y1, y2 })));
+            tri.maxY = std::min(height - 1, (int)std::ceil(std::max({ y0, y1, y2 })) - 1);
+            if (tri.minX > tri.maxX || tri.minY > tri.maxY) continue;
+
+            // E(p) = A x + B y + C >= 0 inside, shifted so E >= 0 at a pixel means the whole pixel is inside
+            for (int e = 0; e < 3; e++) {
+                int a = v[e], b = v[(e + 1) % 3];
+                float A = sy[a] - sy[b];
+                float B = sx[b] - sx[a];
+                float C = -(A * sx[a] + B * sy[a]);
+                tri.edgeA[e] = A;
+                tri.edgeB[e] = B;
+                tri.edgeC[e] = C + 0.5f * (A + B) - 0.5f * (std::fabs(A) + std::fabs(B));
+            }
+
+            // 1/w plane, lowered to its minimum over the pixel square
+            float z0 = iw[v[0]], z1 = iw[v[1]], z2 = iw[v[2]];
+            float P = ((z1 - z0) * (y2 - y0) - (z2 - z0) * (y1 - y0)) / area;
+            float Q = ((z2 - z0) * (x1 - x0) - (z1 - z0) * (x2 - x0)) / area;
+            float R = z0 - P * x0 - Q * y0;
+            tri.depthA = P;
+            tri.depthB = Q;
+            tri.depthC = R + 0.5f * (P + Q) - 0.5f * (std::fabs(P) + std::fabs(Q));
+
+            triangles.push_back(tri);
+        }
+    }
+}
+
+void OcclusionCuller::rasterizeRows(int y0, int y1) {
+    const __m128 laneOffset = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (const Triangle& tri : triangles) {
+        int rowBegin = std::max(tri.minY, y0);
+        int rowEnd = std::min(tri.maxY, y1 - 1);
+        if (rowBegin > rowEnd) continue;
+
+        __m128 A0 = _mm_set1_ps(tri.edgeA[0]), A1 = _mm_set1_ps(tri.edgeA[1]), A2 = _mm_set1_ps(tri.edgeA[2]);
+        __m128 P = _mm_set1_ps(tri.depthA);
+
+        for (int y = rowBegin; y <= rowEnd; y++) {
+            __m128 row0 = _mm_set1_ps(tri.edgeB[0] * y + tri.edgeC[0]);
+            __m128 row1 = _mm_set1_ps(tri.edgeB[1] * y + tri.edgeC[1]);
+            __m128 row2 = _mm_set1_ps(tri.edgeB[2] * y + tri.edgeC[2]);
+            __m128 rowZ = _mm_set1_ps(tri.depthB * y + tri.depthC);
+            float* line = &depth[(size_t)y * width];
+
+            // 4 pixels at a time, width is a multiple of 4 so the last group stays in the row
+            for (int x = tri.minX & ~3; x <= tri.maxX; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffset);
+                __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(A0, px), row0), zero);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(A1, px), row1), zero));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(A2, px), row2), zero));
+                if (_mm_movemask_ps(inside) == 0) continue;
+
+                __m128 z = _mm_add_ps(_mm_mul_ps(P, px), rowZ);
+                __m128 d = _mm_loadu_ps(line + x);
+                _mm_storeu_ps(line + x, _mm_max_ps(d, _mm_and_ps(inside, z)));
+            }
+        }
+    }
+}
+
+void OcclusionCuller::RenderOccluders(const float* centerX, const float* centerY, const float* centerZ,
+    const float* extentX, const float* extentY, const float* extentZ,
+    const uint32_t* candidates, size_t candidateCount) {
+    // rank by rough projected size: face area / distance^2
+    glm::vec4 wRow(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+    scores.clear();
+    for (size_t n = 0; n < candidateCount; n++) {
+        uint32_t i = candidates[n];
+        float w = wRow.x * centerX[i] + wRow.y * centerY[i] + wRow.z * centerZ[i] + wRow.w;
+        float radius = std::sqrt(extentX[i] * extentX[i] + extentY[i] * extentY[i] + extentZ[i] * extentZ[i]);
+        if (w <= radius) continue; // may cross the camera plane
+        float area = extentX[i] * extentY[i] + extentY[i] * extentZ[i] + extentZ[i] * extentX[i];
+        scores.push_back(std::make_pair(area / (w * w), i));
+    }
+    size_t occluderCount = std::min<size_t>(scores.size(), maxOccluders);
+    std::partial_sort(scores.begin(), scores.begin() + occluderCount, scores.end(),
+        [](const std::pair<float, uint32_t>& a, const std::pair<float, uint32_t>& b) { return a.first > b.first; });
+
+    triangles.clear();
+    for (size_t n = 0; n < occluderCount; n++) {
+        uint32_t i = scores[n].second;
+        setupBox(glm::vec3(centerX[i], centerY[i], centerZ[i]), glm::vec3(extentX[i], extentY[i], extentZ[i]));
+    }
+
+    // horizontal bands, each worker owns its rows
+    size_t bands = (height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+    pool->ParallelFor(bands, 1, [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; b++)
+            rasterizeRows((int)b * BAND_HEIGHT, std::min(height, (int)(b + 1) * BAND_HEIGHT));
+    });
+}
+
+bool OcclusionCuller::IsVisible(const glm::vec3& center, const glm::vec3& extent) const {
+    float sx[8], sy[8], iw[8];
+    if (!projectBox(viewProjection, center, extent, width, height, sx, sy, iw)) return true;
+
+    int x0 = std::max(0, (int)std::floor(*std::min_element(sx, sx + 8)));
+    int x1 = std::min(width - 1, (int)std::floor(*std::max_element(sx, sx + 8)));
+    int y0 = std::max(0, (int)std::floor(*std::min_element(sy, sy + 8)));
+    int y1 = std::min(height - 1, (int)std::floor(*std::max_element(sy, sy + 8)));
+    if (x0 > x1 || y0 > y1) return true;
+
+    // nearest point of the box is one of its corners
+    float nearest = *std::max_element(iw, iw + 8);
+    __m128 nearest4 = _mm_set1_ps(nearest);
+
+    for (int y = y0; y <= y1; y++) {
+        const float* line = &depth[(size_t)y * width];
+        int x = x0;
+        for (; x + 3 <= x1; x += 4)
+            if (_mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(line + x), nearest4)) != 0) return true;
+        for (; x <= x1; x++)
+            if (line[x] <= nearest) return true;
+    }
+    return false;
+}
+
+size_t OcclusionCuller::Filter(const float* centerX, const float* centerY, const float* centerZ,
+    const float* extentX, const float* extentY, const float* extentZ,
+    uint32_t* indices, size_t count) {
+    visibleFlags.resize(count);
+    pool->ParallelFor(count, 256, [&](size_t begin, size_t end) {
+        for (size_t n = begin; n < end; n++) {
+            uint32_t i = indices[n];
+            visibleFlags[n] = IsVisible(glm::vec3(centerX[i], centerY[i], centerZ[i]), glm::vec3(extentX[i], extentY[i], extentZ[i]));
+        }
+    });
+
+    size_t kept = 0;
+    for (size_t n = 0; n < count; n++)
+        if (visibleFlags[n]) indices[kept++] = indices[n];
+    return kept;
+}
+
+// --- self test -------------------------------------------------------------
+
+// Plain z-buffer with an instance id per pixel center, to see which boxes really show up
+static void referenceRaster(const glm::mat4& viewProjection, const std::vector<glm::vec3>& centers, const std::vector<glm::vec3>& extents,
+    int width, int height, float farPlane, std::vector<int>& ids) {
+    std::vector<float> zbuffer((size_t)width * height, 1.0f / farPlane); // nothing beyond the far plane
+    ids.assign((size_t)width * height, -1);
+
+    for (size_t i = 0; i < centers.size(); i++) {
+        float sx[8], sy[8], iw[8];
+        if (!projectBox(viewProjection, centers[i], extents[i], width, height, sx, sy, iw)) continue;
+
+        for (int f = 0; f < 6; f++) {
+            for (int t = 0; t < 2; t++) {
+                int v[3] = { BOX_FACES[f][0], BOX_FACES[f][t + 1], BOX_FACES[f][t + 2] };
+                float x0 = sx[v[0]], y0 = sy[v[0]], x1 = sx[v[1]], y1 = sy[v[1]], x2 = sx[v[2]], y2 = sy[v[2]];
+                float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+                if (area <= 0.0f) continue;
+
+                int minX = std::max(0, (int)std::floor(std::min({ x0, x1, x2 })));
+                int maxX = std::min(width - 1, (int)std::ceil(std::max({ x0, x1, x2 })));
+                int minY = std::max(0, (int)std::floor(std::min({ y0, y1, y2 })));
+                int maxY = std::min(height - 1, (int)std::ceil(std::max({ y0, y1, y2 })));
+
+                for (int y = minY; y <= maxY; y++) {
+                    for (int x = minX; x <= maxX; x++) {
+                        float px = x + 0.5f, py = y + 0.5f;
+                        float b0 = (x2 - x1) * (py - y1) - (y2 - y1) * (px - x1);
+                        float b1 = (x0 - x2) * (py - y2) - (y0 - y2) * (px - x2);
+                        float b2 = (x1 - x0) * (py - y0) - (y1 - y0) * (px - x0);
+                        if (b0 < 0.0f || b1 < 0.0f || b2 < 0.0f) continue;
+
+                        float z = (b0 * iw[v[0]] + b1 * iw[v[1]] + b2 * iw[v[2]]) / area;
+                        size_t p = (size_t)y * width + x;
+                        if (z > zbuffer[p]) {
+                            zbuffer[p] = z;
+                            ids[p] = (int)i;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::RunSelfTest() {
+    // same layout as the city in main.cpp
+    std::vector<float> cx, cy, cz, ex, ey, ez;
+    std::vector<glm::vec3> centers, extents;
+    srand(999);
+    for (int x = -20; x < 20; x++) {
+        for (int z = -20; z < 20; z++) {
+            if (abs(x) < 2 && abs(z) < 2) continue;
+            float height = static_cast<float>(rand() % 5 + 1);
+            if (rand() % 100 > 90) height *= 4.0f;
+            if (rand() % 100 > 95) height *= 2.0f;
+            centers.push_back(glm::vec3(x * 3.0f, height / 2.0f, z * 3.0f));
+            extents.push_back(glm::vec3(1.0f, height / 2.0f, 1.0f));
+        }
+    }
+    size_t count = centers.size();
+    size_t padded = (count + 3) / 4 * 4;
+    cx.resize(padded); cy.resize(padded); cz.resize(padded);
+    ex.resize(padded, -1e30f); ey.resize(padded, -1e30f); ez.resize(padded, -1e30f);
+    for (size_t i = 0; i < count; i++) {
+        cx[i] = centers[i].x; cy[i] = centers[i].y; cz[i] = centers[i].z;
+        ex[i] = extents[i].x; ey[i] = extents[i].y; ez[i] = extents[i].z;
+    }
+
+    struct Pose { glm::vec3 position, target; };
+    const Pose poses[] = {
+        { glm::vec3(0.0f, 5.0f, 15.0f), glm::vec3(0.0f, 5.0f, 0.0f) },     // start camera
+        { glm::vec3(1.5f, 1.7f, 1.5f), glm::vec3(1.5f, 1.7f, -50.0f) },    // street level, down the avenue
+        { glm::vec3(1.5f, 1.7f, 1.5f), glm::vec3(40.0f, 1.0f, 30.0f) },    // street level, diagonal
+        { glm::vec3(-30.0f, 2.0f, 25.5f), glm::vec3(30.0f, 3.0f, 25.5f) }, // between rows
+        { glm::vec3(0.0f, 12.0f, 60.0f), glm::vec3(0.0f, 0.0f, 0.0f) },    // above the roofs
+        { glm::vec3(45.0f, 30.0f, 45.0f), glm::vec3(0.0f, 0.0f, 0.0f) },   // high, looking down
+    };
+
+    ThreadPool pool;
+    OcclusionCuller culler(&pool);
+    std::vector<uint32_t> indices(padded);
+    std::vector<int> ids;
+    const int REF_WIDTH = 1024, REF_HEIGHT = 576;
+    bool passed = true;
+
+    std::cout << "Occlusion culling self test, " << count << " boxes, " << culler.width << "x" << culler.height
+              << " depth buffer, " << pool.GetThreadCount() + 1 << " threads" << std::endl;
+
+    for (const Pose& pose : poses) {
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+        glm::mat4 viewProjection = projection * glm::lookAt(pose.position, pose.target, glm::vec3(0.0f, 1.0f, 0.0f));
+        Frustum frustum(viewProjection);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        size_t inFrustum = frustum.CullAABBs(cx.data(), cy.data(), cz.data(), ex.data(), ey.data(), ez.data(), padded, indices.data());
+        culler.Begin(viewProjection);
+        culler.RenderOccluders(cx.data(), cy.data(), cz.data(), ex.data(), ey.data(), ez.data(), indices.data(), inFrustum);
+        size_t kept = culler.Filter(cx.data(), cy.data(), cz.data(), ex.data(), ey.data(), ez.data(), indices.data(), inFrustum);
+        auto stop = std::chrono::high_resolution_clock::now();
+
+        std::vector<bool> keptFlags(count, false);
+        for (size_t n = 0; n < kept; n++) keptFlags[indices[n]] = true;
+
+        referenceRaster(viewProjection, centers, extents, REF_WIDTH, REF_HEIGHT, 100.0f, ids);
+        std::vector<bool> seen(count, false);
+        for (int id : ids)
+            if (id >= 0) seen[id] = true;
+
+        size_t seenCount = 0, wrong = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (!seen[i]) continue;
+            seenCount++;
+            if (!keptFlags[i]) wrong++;
+        }
+        if (wrong > 0) passed = false;
+
+        std::cout << "  pose (" << pose.position.x << ", " << pose.position.y << ", " << pose.position.z << "): "
+                  << inFrustum << " in frustum, " << inFrustum - kept << " occluded, " << kept << " drawn, "
+                  << seenCount << " really visible, " << wrong << " wrongly culled, "
+                  << std::chrono::duration<double, std::milli>(stop - start).count() << " ms" << std::endl;
+    }
+
+    std::cout << (passed ? "PASSED" : "FAILED") << std::endl;
+    return passed;
+}
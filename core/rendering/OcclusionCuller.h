@@ -0,0 +1,54 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "../ThreadPool.h"
+
+// Conservative CPU occlusion culling against a small software depth buffer.
+// The nearest large boxes are rasterized as occluders: a pixel is only written when an
+// occluder triangle covers it completely, with the triangle's farthest depth inside it.
+// Boxes are then rejected only if every pixel under their screen bounds holds something
+// strictly nearer than their nearest corner.
+// Depth is 1/w (affine in screen space), 0 = nothing. Pure CPU code, no GL calls.
+// Occluders are instance AABBs, so they must be solid boxes (true for the city buildings).
+class OcclusionCuller {
+public:
+    int width, height;          // width is a multiple of 4 (SSE rows)
+    unsigned int maxOccluders;
+    std::vector<float> depth;   // 1/w per pixel, larger is nearer, row 0 at the bottom
+
+    OcclusionCuller(ThreadPool* pool, int width = 256, int height = 144, unsigned int maxOccluders = 96);
+
+    // Start a frame: clear the depth buffer
+    void Begin(const glm::mat4& viewProjection);
+    // Pick the best occluders among `candidates` (indices into the SoA boxes) and rasterize them
+    void RenderOccluders(const float* centerX, const float* centerY, const float* centerZ,
+        const float* extentX, const float* extentY, const float* extentZ,
+        const uint32_t* candidates, size_t candidateCount);
+    // Drop occluded boxes from `indices` (order is kept), returns the new count
+    size_t Filter(const float* centerX, const float* centerY, const float* centerZ,
+        const float* extentX, const float* extentY, const float* extentZ,
+        uint32_t* indices, size_t count);
+
+    bool IsVisible(const glm::vec3& center, const glm::vec3& extent) const;
+
+    // Checks conservativeness on fixed camera poses against a high resolution
+    // reference rasterizer (no GL needed). Returns false on any wrongly culled box.
+    static bool RunSelfTest();
+
+private:
+    struct Triangle {
+        float edgeA[3], edgeB[3], edgeC[3]; // inner-coverage edge functions (pixel centers)
+        float depthA, depthB, depthC;       // 1/w plane, already lowered to the pixel's farthest point
+        int minX, maxX, minY, maxY;
+    };
+
+    ThreadPool* pool;
+    glm::mat4 viewProjection;
+    std::vector<Triangle> triangles;
+    std::vector<std::pair<float, uint32_t>> scores;
+    std::vector<uint8_t> visibleFlags;
+
+    void setupBox(const glm::vec3& center, const glm::vec3& extent);
+    void rasterizeRows(int y0, int y1);
+};
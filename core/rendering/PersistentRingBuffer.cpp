@@ -0,0 +1,56 @@
+#include "PersistentRingBuffer.h"
+#include <iostream>
+
+PersistentRingBuffer::PersistentRingBuffer(GLenum target, GLsizeiptr size, GLsizeiptr alignment)
+    : target(target), mapped(nullptr), frame(0), waited(false) {
+    for (unsigned int i = 0; i < FRAME_COUNT; i++) fences[i] = 0;
+
+    if (alignment < 1) alignment = 1;
+    if (size < 1) size = 1;
+    regionSize = (size + alignment - 1) / alignment * alignment;
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+    glBufferStorage(target, regionSize * FRAME_COUNT, NULL, flags);
+    mapped = (unsigned char*)glMapBufferRange(target, 0, regionSize * FRAME_COUNT, flags);
+    glBindBuffer(target, 0);
+
+    if (mapped == nullptr)
+        std::cout << "PersistentRingBuffer: failed to map buffer!" << std::endl;
+}
+
+PersistentRingBuffer::~PersistentRingBuffer() {
+    for (unsigned int i = 0; i < FRAME_COUNT; i++)
+        if (fences[i]) glDeleteSync(fences[i]);
+
+    glBindBuffer(target, buffer);
+    glUnmapBuffer(target);
+    glBindBuffer(target, 0);
+    glDeleteBuffers(1, &buffer);
+}
+
+void PersistentRingBuffer::waitForRegion() {
+    if (waited) return;
+    waited = true;
+
+    GLsync& fence = fences[frame];
+    if (!fence) return;
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    while (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED && result != GL_WAIT_FAILED)
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+    glDeleteSync(fence);
+    fence = 0;
+}
+
+unsigned char* PersistentRingBuffer::Map() {
+    waitForRegion();
+    return mapped + regionSize * frame;
+}
+
+void PersistentRingBuffer::EndFrame() {
+    if (fences[frame]) glDeleteSync(fences[frame]);
+    fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frame = (frame + 1) % FRAME_COUNT;
+    waited = false;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <glad/glad.h>
+
+// Persistently mapped buffer split into FRAME_COUNT regions.
+// The CPU writes frame N into one region while the GPU still reads N-1 / N-2,
+// a fence per region keeps them from overlapping. No orphaning, no implicit syncs.
+class PersistentRingBuffer {
+public:
+    static const unsigned int FRAME_COUNT = 3;
+
+    unsigned int buffer;
+    GLsizeiptr regionSize; // bytes per region, rounded up to the alignment
+
+    // alignment: region offsets are a multiple of it (binding offset alignment / element stride)
+    PersistentRingBuffer(GLenum target, GLsizeiptr size, GLsizeiptr alignment);
+    ~PersistentRingBuffer();
+
+    // Wait for the current region and return its write pointer
+    unsigned char* Map();
+    GLintptr GetRegionOffset() const { return regionSize * frame; }
+    unsigned int GetFrame() const { return frame; }
+
+    // Call once the frame's draws are submitted, then move on to the next region
+    void EndFrame();
+
+private:
+    GLenum target;
+    unsigned char* mapped;
+    GLsync fences[FRAME_COUNT];
+    unsigned int frame;
+    bool waited;
+
+    void waitForRegion();
+};
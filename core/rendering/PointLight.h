@@ -0,0 +1,19 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// SSBO binding points shared by the lighting shaders
+const unsigned int LIGHT_SSBO_BINDING = 0;
+const unsigned int CLUSTER_SSBO_BINDING = 1;
+const unsigned int LIGHT_INDEX_SSBO_BINDING = 2;
+
+// std430 mirror of `struct Light` in deferred_shading.frag (48 bytes)
+struct PointLight {
+    glm::vec3 Position;
+    float Radius;       // influence radius, used for culling and as the shading cutoff
+    glm::vec3 Color;
+    float Linear;
+    float Quadratic;
+    float pad[3];
+};
+
+static_assert(sizeof(PointLight) == 48, "PointLight must match the std430 layout of Light");
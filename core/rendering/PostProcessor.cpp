@@ -1,63 +1,73 @@
 #include "PostProcessor.h"
+#include <algorithm>
 
-PostProcessor::PostProcessor(int w, int h) : width(w), height(h) {
+PostProcessor::PostProcessor(int w, int h, RenderTargetPool* pool)
+    : pool(pool), sceneTarget(nullptr), depthTarget(nullptr), bloomThreshold(2.0f), bloomKnee(0.5f),
+    bloomIntensity(1.0f / BLOOM_MIP_COUNT), width(w), height(h) {
     // 1. J Shaders
-    blurShader = new Shader("assets/shaders/debug_quad.vert", "assets/shaders/blur.frag");
+    downsampleShader = new Shader("assets/shaders/debug_quad.vert", "assets/shaders/bloom_downsample.frag");
+    upsampleShader = new Shader("assets/shaders/debug_quad.vert", "assets/shaders/bloom_upsample.frag");
     finalShader = new Shader("assets/shaders/debug_quad.vert", "assets/shaders/final_bloom.frag");
 
-    blurShader->use();
-    blurShader->setInt("image", 0);
+    downsampleShader->use();
+    downsampleShader->setInt("srcTexture", 0);
+    upsampleShader->use();
+    upsampleShader->setInt("srcTexture", 0);
     finalShader->use();
     finalShader->setInt("scene", 0);
     finalShader->setInt("bloomBlur", 1);
 
-    // 2. إ HDR FBO (Color + Brightness)
+    // 2. إ HDR FBO (Color)
+    // targets come from the pool every frame, attached in BeginRender()
     glGenFramebuffers(1, &hdrFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-    glGenTextures(2, colorBuffers);
-    for (unsigned int i = 0; i < 2; i++) {
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colorBuffers[i], 0);
-    }
-    unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-    glDrawBuffers(2, attachments);
-
-    // Depth Buffer (Forward Pass ݭn)
-    glGenRenderbuffers(1, &rboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "HDR FBO not complete!" << std::endl;
-
-    // 3. إ Ping-Pong FBOs
-    glGenFramebuffers(2, pingpongFBO);
-    glGenTextures(2, pingpongColorbuffers);
-    for (unsigned int i = 0; i < 2; i++) {
-        glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[i]);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pingpongColorbuffers[i], 0);
-    }
+    colorBuffer = 0;
+    depthBuffer = 0;
+    poolGeneration = 0;
+    for (unsigned int i = 0; i < BLOOM_MIP_COUNT; i++) bloomMips[i] = nullptr;
+
+    float black[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+    glGenTextures(1, &blackTexture);
+    glBindTexture(GL_TEXTURE_2D, blackTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_FLOAT, black);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 PostProcessor::~PostProcessor() {
-    delete blurShader;
+    delete downsampleShader;
+    delete upsampleShader;
     delete finalShader;
+    glDeleteFramebuffers(1, &hdrFBO);
+    glDeleteTextures(1, &blackTexture);
+}
+
+void PostProcessor::Release() {
+    pool->Release(sceneTarget);
+    pool->Release(depthTarget);
+}
+
+void PostProcessor::ReleaseBloom() {
+    for (unsigned int i = 0; i < BLOOM_MIP_COUNT; i++) pool->Release(bloomMips[i]);
 }
 
 void PostProcessor::BeginRender() {
+    Release();
+    sceneTarget = pool->Acquire({ width, height, GL_RGBA16F, RenderTargetUsage::Color });
+    depthTarget = pool->Acquire({ width, height, GL_DEPTH_COMPONENT24, RenderTargetUsage::Depth }, GL_NEAREST); // same format as the G-buffer depth (blitted)
+
     glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
+    // re-attach only when the pool handed out different textures (same ids after a free may be new storage)
+    if (colorBuffer != sceneTarget->texture || depthBuffer != depthTarget->texture || pool->GetGeneration() != poolGeneration) {
+        poolGeneration = pool->GetGeneration();
+        colorBuffer = sceneTarget->texture;
+        depthBuffer = depthTarget->texture;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorBuffer, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthBuffer, 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "HDR FBO not complete!" << std::endl;
+    }
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 }
 
@@ -66,33 +76,60 @@ void PostProcessor::EndRender() {
 }
 
 void PostProcessor::RenderBloom() {
-    bool horizontal = true, first_iteration = true;
-    unsigned int amount = 5;
-    blurShader->use();
+    ReleaseBloom();
 
-    for (unsigned int i = 0; i < amount; i++) {
-        glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
-        blurShader->setInt("horizontal", horizontal);
+    // 1. Downsample: scene -> mip 0 (bright pass) -> mip 1 -> ...
+    downsampleShader->use();
+    downsampleShader->setFloat("threshold", bloomThreshold);
+    downsampleShader->setFloat("knee", bloomKnee);
+    glActiveTexture(GL_TEXTURE0);
 
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, first_iteration ? colorBuffers[1] : pingpongColorbuffers[!horizontal]);
+    unsigned int source = colorBuffer;
+    int mipWidth = width, mipHeight = height;
+    for (unsigned int i = 0; i < BLOOM_MIP_COUNT; i++) {
+        mipWidth = std::max(mipWidth / 2, 1);
+        mipHeight = std::max(mipHeight / 2, 1);
+        bloomMips[i] = pool->Acquire({ mipWidth, mipHeight, GL_R11F_G11F_B10F, RenderTargetUsage::Color });
+
+        glBindFramebuffer(GL_FRAMEBUFFER, bloomMips[i]->fbo);
+        glViewport(0, 0, mipWidth, mipHeight);
+        downsampleShader->setBool("firstPass", i == 0);
+        glBindTexture(GL_TEXTURE_2D, source);
+        Primitives::renderQuad();
+        source = bloomMips[i]->texture;
+    }
 
+    // 2. Upsample: every level adds the tent filtered smaller one, mip 0 ends up with the whole chain
+    upsampleShader->use();
+    upsampleShader->setFloat("filterRadius", 1.0f);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    for (unsigned int i = BLOOM_MIP_COUNT - 1; i > 0; i--) {
+        RenderTarget* target = bloomMips[i - 1];
+        glBindFramebuffer(GL_FRAMEBUFFER, target->fbo);
+        glViewport(0, 0, target->desc.width, target->desc.height);
+        glBindTexture(GL_TEXTURE_2D, bloomMips[i]->texture);
         Primitives::renderQuad();
 
-        horizontal = !horizontal;
-        first_iteration = false;
+        // only mip 0 is read by RenderFinal()
+        pool->Release(bloomMips[i]);
     }
+    glDisable(GL_BLEND);
+
+    glViewport(0, 0, width, height);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void PostProcessor::RenderFinal(float exposure) {
+void PostProcessor::RenderFinal(float exposure, bool autoExposure) {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     finalShader->use();
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, colorBuffers[0]); // Scene
+    glBindTexture(GL_TEXTURE_2D, colorBuffer); // Scene
     glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[0]); // Blurred Bright
+    glBindTexture(GL_TEXTURE_2D, bloomMips[0] ? bloomMips[0]->texture : blackTexture); // Blurred Bright
 
     finalShader->setFloat("exposure", exposure);
+    finalShader->setBool("autoExposure", autoExposure);
+    finalShader->setFloat("bloomIntensity", bloomIntensity);
     Primitives::renderQuad();
 }
\ No newline at end of file
@@ -3,25 +3,44 @@
 #include <iostream>
 #include "../Shader.h"
 #include "Primitives.h"
+#include "RenderTargetPool.h"
+
+// 1/2, 1/4, ... 1/64 of the screen
+const unsigned int BLOOM_MIP_COUNT = 6;
 
 class PostProcessor {
 public:
     unsigned int hdrFBO;
-    unsigned int colorBuffers[2]; // 0: Scene, 1: Brightness
-    unsigned int rboDepth;
+    unsigned int colorBuffer; // Scene (texture of the pooled target)
+    unsigned int depthBuffer;
+
+    // pooled targets, acquired in BeginRender() / RenderBloom(), released by the frame graph after RenderFinal()
+    RenderTargetPool* pool;
+    RenderTarget* sceneTarget;
+    RenderTarget* depthTarget;
+    RenderTarget* bloomMips[BLOOM_MIP_COUNT]; // only mip 0 survives RenderBloom()
+    unsigned int poolGeneration; // pool generation of the textures attached to hdrFBO
 
-    unsigned int pingpongFBO[2];
-    unsigned int pingpongColorbuffers[2];
+    unsigned int blackTexture; // bloom input when bloom is off
+
+    float bloomThreshold; // luminance, applied in the first downsample
+    float bloomKnee;
+    float bloomIntensity; // the chain sums every mip level
 
     int width, height;
-    Shader* blurShader;
+    Shader* downsampleShader;
+    Shader* upsampleShader;
     Shader* finalShader;
 
-    PostProcessor(int w, int h);
+    PostProcessor(int w, int h, RenderTargetPool* pool);
     ~PostProcessor(); // Oo@ cleanup
 
     void BeginRender(); // jw HDR FBO
     void EndRender();   // Ѹj
-    void RenderBloom(); //  Ping-Pong Blur
-    void RenderFinal(float exposure); // XÿXù
+    void RenderBloom(); // 13-tap downsample / tent upsample over the mip chain
+    void Resize(int w, int h) { width = w; height = h; }
+    void RenderFinal(float exposure, bool autoExposure = false); // autoExposure: exposure SSBO (binding 3) instead, XÿXù
+
+    void Release();      // scene + depth targets
+    void ReleaseBloom(); // bloom mip chain
 };
\ No newline at end of file
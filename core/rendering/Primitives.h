@@ -1,11 +1,15 @@
 #pragma once
 #include <glad/glad.h>
+#include "MeshBuffer.h"
 
 class Primitives {
 public:
-    static void renderCube();
+    static void renderCube(int instances = 1);
     static void renderQuad();
+    static void renderSphere(int instances = 1); // low-poly sphere enclosing the unit sphere
 private:
-    static unsigned int cubeVAO, cubeVBO;
+    static MeshBuffer* cube;
     static unsigned int quadVAO, quadVBO;
+    static unsigned int sphereVAO, sphereVBO, sphereEBO;
+    static unsigned int sphereIndexCount;
 };
\ No newline at end of file
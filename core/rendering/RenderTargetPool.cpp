@@ -0,0 +1,121 @@
+#include "RenderTargetPool.h"
+#include <algorithm>
+#include <iostream>
+
+RenderTargetPool::RenderTargetPool() : frame(0), peakBytes(0), generation(0) {
+}
+
+RenderTargetPool::~RenderTargetPool() {
+    for (RenderTarget* target : targets) destroy(target);
+}
+
+size_t RenderTargetPool::GetBytesPerPixel(GLenum internalFormat) {
+    switch (internalFormat) {
+    case GL_R8: return 1;
+    case GL_R16F: case GL_RG8: return 2;
+    case GL_RGBA16F: case GL_RG32F: return 8;
+    case GL_RGBA32F: return 16;
+    case GL_RGB16F: return 8; // padded
+    default: return 4; // RGBA8, RGB8 (padded), RG16F, RG16_SNORM, R32F, R11F_G11F_B10F, DEPTH_COMPONENT24 / 32F
+    }
+}
+
+RenderTarget* RenderTargetPool::create(const RenderTargetDesc& desc) {
+    RenderTarget* target = new RenderTarget();
+    target->desc = desc;
+    target->inUse = false;
+    target->lastUsedFrame = frame;
+
+    glGenTextures(1, &target->texture);
+    glBindTexture(GL_TEXTURE_2D, target->texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, desc.internalFormat, desc.width, desc.height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    GLint previousFBO = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFBO);
+    glGenFramebuffers(1, &target->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, target->fbo);
+    if (desc.usage == RenderTargetUsage::Depth) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, target->texture, 0);
+        glDrawBuffer(GL_NONE);
+    }
+    else {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target->texture, 0);
+    }
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "RenderTargetPool: framebuffer not complete!" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFBO);
+
+    targets.push_back(target);
+    peakBytes = std::max(peakBytes, GetAllocatedBytes());
+    return target;
+}
+
+void RenderTargetPool::destroy(RenderTarget* target) {
+    glDeleteFramebuffers(1, &target->fbo);
+    glDeleteTextures(1, &target->texture);
+    delete target;
+    generation++;
+}
+
+RenderTarget* RenderTargetPool::Acquire(const RenderTargetDesc& desc, GLenum filter) {
+    RenderTarget* target = nullptr;
+    for (RenderTarget* candidate : targets) {
+        if (!candidate->inUse && candidate->desc == desc) {
+            target = candidate;
+            break;
+        }
+    }
+    if (target == nullptr) target = create(desc);
+
+    target->inUse = true;
+    target->lastUsedFrame = frame;
+    glBindTexture(GL_TEXTURE_2D, target->texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    return target;
+}
+
+void RenderTargetPool::Release(RenderTarget*& target) {
+    if (target == nullptr) return;
+    target->inUse = false;
+    target->lastUsedFrame = frame;
+    target = nullptr;
+}
+
+void RenderTargetPool::EndFrame() {
+    frame++;
+    // free targets nobody asked for lately (e.g. the old size after a resize)
+    for (size_t i = 0; i < targets.size();) {
+        RenderTarget* target = targets[i];
+        if (!target->inUse && frame - target->lastUsedFrame > MAX_IDLE_FRAMES) {
+            destroy(target);
+            targets[i] = targets.back();
+            targets.pop_back();
+        }
+        else {
+            i++;
+        }
+    }
+}
+
+void RenderTargetPool::Clear() {
+    for (size_t i = 0; i < targets.size();) {
+        if (targets[i]->inUse) {
+            std::cout << "RenderTargetPool: clearing a target that is still in use!" << std::endl;
+            i++;
+            continue;
+        }
+        destroy(targets[i]);
+        targets[i] = targets.back();
+        targets.pop_back();
+    }
+}
+
+size_t RenderTargetPool::GetAllocatedBytes() const {
+    size_t bytes = 0;
+    for (const RenderTarget* target : targets)
+        bytes += (size_t)target->desc.width * target->desc.height * GetBytesPerPixel(target->desc.internalFormat);
+    return bytes;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+enum class RenderTargetUsage {
+    Color, // color attachment, sampled afterwards
+    Depth  // depth attachment, sampled or blitted afterwards
+};
+
+// Pool key
+struct RenderTargetDesc {
+    int width, height;
+    GLenum internalFormat; // sized format (GL_RGBA16F, GL_R8, GL_DEPTH_COMPONENT24, ...)
+    RenderTargetUsage usage;
+
+    bool operator==(const RenderTargetDesc& other) const {
+        return width == other.width && height == other.height && internalFormat == other.internalFormat && usage == other.usage;
+    }
+};
+
+// One pooled texture with its own single-attachment FBO
+struct RenderTarget {
+    RenderTargetDesc desc;
+    unsigned int texture;
+    unsigned int fbo;
+    bool inUse;
+    unsigned int lastUsedFrame;
+};
+
+// Transient render targets shared between passes.
+// A pass acquires a target when it starts writing it and releases it after its last reader,
+// a later pass asking for the same (size, format, usage) gets the same texture back.
+// GL has no placement aliasing, so memory is aliased by reusing whole textures.
+// Targets idle for a few frames (old sizes after a resize) are freed in EndFrame().
+class RenderTargetPool {
+public:
+    static const unsigned int MAX_IDLE_FRAMES = 3;
+
+    RenderTargetPool();
+    ~RenderTargetPool();
+
+    // filter: set on every acquire, the previous user may have sampled it differently
+    RenderTarget* Acquire(const RenderTargetDesc& desc, GLenum filter = GL_LINEAR);
+    // Returns the target to the pool and clears the pointer (null is ignored)
+    void Release(RenderTarget*& target);
+
+    void EndFrame();
+    void Clear(); // frees every target, none may be in use
+
+    size_t GetAllocatedBytes() const;
+    size_t GetPeakBytes() const { return peakBytes; }
+    size_t GetTargetCount() const { return targets.size(); }
+    // Bumped whenever a texture is freed: GL may hand its name to the next new texture,
+    // so a cached texture id only identifies the same storage while the generation is unchanged
+    unsigned int GetGeneration() const { return generation; }
+
+    static size_t GetBytesPerPixel(GLenum internalFormat);
+
+private:
+    std::vector<RenderTarget*> targets;
+    unsigned int frame;
+    size_t peakBytes;
+    unsigned int generation;
+
+    RenderTarget* create(const RenderTargetDesc& desc);
+    void destroy(RenderTarget* target);
+};
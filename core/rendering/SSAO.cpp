@@ -1,48 +1,44 @@
 #include "SSAO.h"
 #include <glm/gtc/type_ptr.hpp>
 
-SSAO::SSAO(int w, int h) : width(w), height(h) {
+SSAO::SSAO(int w, int h, RenderTargetPool* pool)
+    : pool(pool), ssaoTarget(nullptr), ssaoBlurTarget(nullptr), width(w), height(h), resolutionDivisor(2), kernelSize(32) {
     // 1. J Shaders
-    ssaoShader = new Shader("assets/shaders/debug_quad.vert", "assets/shaders/ssao.frag");
+    ssaoVariants = new ShaderVariants("assets/shaders/debug_quad.vert", "assets/shaders/ssao.frag",
+        { "COMPACT_GBUFFER", "KERNEL_SIZE 16", "KERNEL_SIZE 32", "KERNEL_SIZE 64" }, [](Shader& shader) {
+            shader.setInt("gPosition", 0);
+            shader.setInt("gNormal", 1);
+            shader.setInt("texNoise", 2);
+            shader.setInt("gDepth", 3);
+        });
+    ssaoShader = ssaoVariants->Get(getVariant(false));
     ssaoBlurShader = new Shader("assets/shaders/debug_quad.vert", "assets/shaders/ssao_blur.frag");
+    ssaoUpsampleShader = new Shader("assets/shaders/debug_quad.vert", "assets/shaders/ssao_upsample.frag");
 
-    // 2. إ SSAO Framebuffer
-    glGenFramebuffers(1, &ssaoFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
-
-    glGenTextures(1, &ssaoColorBuffer);
-    glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
-    // SSAO Guݭn@ӬqD (0.0~1.0)
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColorBuffer, 0);
-
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "SSAO Framebuffer not complete!" << std::endl;
-
-    // 3. إ Blur Framebuffer
-    glGenFramebuffers(1, &ssaoBlurFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
-
-    glGenTextures(1, &ssaoColorBufferBlur);
-    glBindTexture(GL_TEXTURE_2D, ssaoColorBufferBlur);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColorBufferBlur, 0);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    // 4. ֤ͦ߻Pn
+    ssaoBlurShader->use();
+    ssaoBlurShader->setInt("ssaoInput", 0);
+    ssaoBlurShader->setInt("gNormal", 1);
+    ssaoUpsampleShader->use();
+    ssaoUpsampleShader->setInt("ssaoInput", 0);
+    ssaoUpsampleShader->setInt("gPosition", 1);
+    ssaoUpsampleShader->setInt("gDepth", 2);
+
+    glGenBuffers(1, &kernelUBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, kernelUBO);
+    glBufferData(GL_UNIFORM_BUFFER, SSAO_MAX_KERNEL_SIZE * sizeof(glm::vec4), NULL, GL_STATIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // 2. ֤ͦ߻Pn
     generateKernel();
     generateNoiseTexture();
 }
 
 SSAO::~SSAO() {
-    delete ssaoShader;
+    delete ssaoVariants;
     delete ssaoBlurShader;
-    // Oo delete buffers...
+    delete ssaoUpsampleShader;
+    glDeleteTextures(1, &noiseTexture);
+    glDeleteBuffers(1, &kernelUBO);
 }
 
 float SSAO::lerp(float a, float b, float f) {
@@ -52,9 +48,10 @@ float SSAO::lerp(float a, float b, float f) {
 void SSAO::generateKernel() {
     std::uniform_real_distribution<GLfloat> randomFloats(0.0, 1.0);
     std::default_random_engine generator;
+    ssaoKernel.clear();
 
     // ͦ 64 HļI (by)
-    for (unsigned int i = 0; i < 64; ++i) {
+    for (int i = 0; i < kernelSize; ++i) {
         glm::vec3 sample(
             randomFloats(generator) * 2.0 - 1.0,
             randomFloats(generator) * 2.0 - 1.0,
@@ -64,12 +61,34 @@ void SSAO::generateKernel() {
         sample *= randomFloats(generator);
 
         // ļIaI (Scale distribution)
-        float scale = float(i) / 64.0;
+        float scale = float(i) / kernelSize;
         scale = lerp(0.1f, 1.0f, scale * scale);
         sample *= scale;
 
         ssaoKernel.push_back(sample);
     }
+
+    // std140: vec4 per sample
+    std::vector<glm::vec4> packed(ssaoKernel.size());
+    for (size_t i = 0; i < ssaoKernel.size(); i++) packed[i] = glm::vec4(ssaoKernel[i], 0.0f);
+    glBindBuffer(GL_UNIFORM_BUFFER, kernelUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, packed.size() * sizeof(glm::vec4), packed.data());
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void SSAO::SetQuality(int resolutionDivisor, int kernelSize) {
+    this->resolutionDivisor = std::max(resolutionDivisor, 1);
+    this->kernelSize = std::min(std::max(kernelSize, 1), (int)SSAO_MAX_KERNEL_SIZE);
+    generateKernel();
+}
+
+// kernel sizes of the quality tiers are compiled in, any other size reads the kernelSize uniform
+uint32_t SSAO::getVariant(bool compact) const {
+    uint32_t variant = compact ? 1u : 0u;
+    if (kernelSize == 16) variant |= 1u << 1;
+    else if (kernelSize == 32) variant |= 1u << 2;
+    else if (kernelSize == 64) variant |= 1u << 3;
+    return variant;
 }
 
 void SSAO::generateNoiseTexture() {
@@ -96,42 +115,86 @@ void SSAO::generateNoiseTexture() {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 }
 
-void SSAO::Compute(unsigned int gPosition, unsigned int gNormal, const glm::mat4& projection, const glm::mat4& view) {
-    glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
+void SSAO::Compute(GBuffer* gBuffer, const glm::mat4& projection, const glm::mat4& view) {
+    Release();
+    int aoWidth = getAOWidth(), aoHeight = getAOHeight();
+    ssaoTarget = pool->Acquire({ aoWidth, aoHeight, GL_RG16F, RenderTargetUsage::Color }, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, ssaoTarget->fbo);
+    glViewport(0, 0, aoWidth, aoHeight);
     glClear(GL_COLOR_BUFFER_BIT);
 
+    ssaoShader = ssaoVariants->Get(getVariant(gBuffer->layout == GBufferLayout::Compact));
     ssaoShader->use();
 
     // ǤJ G-Buffer
-    glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, gPosition);
-    glActiveTexture(GL_TEXTURE1); glBindTexture(GL_TEXTURE_2D, gNormal);
+    glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, gBuffer->gPosition);
+    glActiveTexture(GL_TEXTURE1); glBindTexture(GL_TEXTURE_2D, gBuffer->gNormal);
     glActiveTexture(GL_TEXTURE2); glBindTexture(GL_TEXTURE_2D, noiseTexture);
+    glActiveTexture(GL_TEXTURE3); glBindTexture(GL_TEXTURE_2D, gBuffer->gDepth);
 
-    ssaoShader->setInt("gPosition", 0);
-    ssaoShader->setInt("gNormal", 1);
-    ssaoShader->setInt("texNoise", 2);
-
-    // ǤJx}P֤
+    // ǤJx}P֤ (kernel: UBO)
     ssaoShader->setMat4("projection", glm::value_ptr(projection));
     ssaoShader->setMat4("view", glm::value_ptr(view));
-
-    for (unsigned int i = 0; i < 64; ++i)
-        ssaoShader->setVec3("samples[" + std::to_string(i) + "]", ssaoKernel[i]);
+    ssaoShader->setInt("kernelSize", kernelSize);
+    ssaoShader->setVec2("noiseScale", glm::vec2(aoWidth / 4.0f, aoHeight / 4.0f));
+    glBindBufferBase(GL_UNIFORM_BUFFER, SSAO_KERNEL_UBO_BINDING, kernelUBO);
 
     // e Quad Ĳop
     Primitives::renderQuad();
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-void SSAO::Blur() {
-    glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
-    glClear(GL_COLOR_BUFFER_BIT);
+void SSAO::Blur(GBuffer* gBuffer, const glm::mat4& projection, const glm::mat4& view) {
+    int aoWidth = getAOWidth(), aoHeight = getAOHeight();
+    bool compact = gBuffer->layout == GBufferLayout::Compact;
 
+    // 1. separable bilateral blur: raw -> temp (horizontal) -> raw (vertical)
+    RenderTarget* temp = pool->Acquire({ aoWidth, aoHeight, GL_RG16F, RenderTargetUsage::Color }, GL_NEAREST);
     ssaoBlurShader->use();
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
-    ssaoBlurShader->setInt("ssaoInput", 0);
+    ssaoBlurShader->setBool("compactGBuffer", compact);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, gBuffer->gNormal);
+
+    RenderTarget* source[2] = { ssaoTarget, temp };
+    RenderTarget* destination[2] = { temp, ssaoTarget };
+    for (int pass = 0; pass < 2; pass++) {
+        glBindFramebuffer(GL_FRAMEBUFFER, destination[pass]->fbo);
+        ssaoBlurShader->setVec2("direction", pass == 0 ? glm::vec2(1.0f, 0.0f) : glm::vec2(0.0f, 1.0f));
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, source[pass]->texture);
+        Primitives::renderQuad();
+    }
+    pool->Release(temp);
+    glViewport(0, 0, width, height);
+
+    // 2. full resolution: the blurred target is the result
+    if (resolutionDivisor == 1) {
+        ssaoBlurTarget = ssaoTarget;
+        ssaoTarget = nullptr;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return;
+    }
+
+    // 3. joint bilateral upsample, guided by the full resolution depth
+    ssaoBlurTarget = pool->Acquire({ width, height, GL_R8, RenderTargetUsage::Color }, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurTarget->fbo);
+
+    ssaoUpsampleShader->use();
+    ssaoUpsampleShader->setBool("compactGBuffer", compact);
+    ssaoUpsampleShader->setMat4("projection", glm::value_ptr(projection));
+    ssaoUpsampleShader->setMat4("view", glm::value_ptr(view));
+    glActiveTexture(GL_TEXTURE0); glBindTexture(GL_TEXTURE_2D, ssaoTarget->texture);
+    glActiveTexture(GL_TEXTURE1); glBindTexture(GL_TEXTURE_2D, gBuffer->gPosition);
+    glActiveTexture(GL_TEXTURE2); glBindTexture(GL_TEXTURE_2D, gBuffer->gDepth);
 
     Primitives::renderQuad();
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // low resolution AO is done, the pool can hand it out again
+    pool->Release(ssaoTarget);
+}
+
+void SSAO::Release() {
+    pool->Release(ssaoTarget);
+    pool->Release(ssaoBlurTarget);
 }
\ No newline at end of file
@@ -3,36 +3,61 @@
 #include <glm/glm.hpp>
 #include <vector>
 #include <random>
+#include <algorithm>
 #include "../Shader.h"
+#include "../ShaderVariants.h"
 #include "../GBuffer.h"
 #include "../Camera.h"
 #include "Primitives.h"
+#include "RenderTargetPool.h"
 
+// UBO binding of the sample kernel (ssao.frag)
+const unsigned int SSAO_KERNEL_UBO_BINDING = 0;
+const unsigned int SSAO_MAX_KERNEL_SIZE = 64;
+
+// AO at 1/resolutionDivisor of the screen: Compute() writes AO + linear depth (RG16F),
+// Blur() runs a separable depth / normal aware blur and a joint bilateral upsample to full resolution.
 class SSAO {
 public:
-    unsigned int ssaoFBO, ssaoBlurFBO;
-    unsigned int ssaoColorBuffer, ssaoColorBufferBlur;
+    RenderTargetPool* pool;
+    RenderTarget* ssaoTarget;     // raw AO + depth (low resolution), Compute() -> Blur()
+    RenderTarget* ssaoBlurTarget; // blurred AO (full resolution), Blur() -> Release()
     unsigned int noiseTexture;
+    unsigned int kernelUBO;
 
     std::vector<glm::vec3> ssaoKernel;
-    Shader* ssaoShader;
+    ShaderVariants* ssaoVariants; // ssao.frag: compact G-buffer, kernel sizes 16 / 32 / 64 compiled in
+    Shader* ssaoShader;           // variant of the last Compute()
     Shader* ssaoBlurShader;
+    Shader* ssaoUpsampleShader;
 
     int width, height;
+    int resolutionDivisor; // 1 full, 2 half, 4 quarter
+    int kernelSize;
 
-    SSAO(int w, int h);
+    SSAO(int w, int h, RenderTargetPool* pool);
     ~SSAO();
 
     // p SSAO (Ū G-BufferAX ssaoColorBuffer)
-    void Compute(unsigned int gPosition, unsigned int gNormal, const glm::mat4& projection, const glm::mat4& view);
+    void Compute(GBuffer* gBuffer, const glm::mat4& projection, const glm::mat4& view);
+
+    // ҽk SSAO (hI), then upsample with the G-buffer depth
+    void Blur(GBuffer* gBuffer, const glm::mat4& projection, const glm::mat4& view);
 
-    // ҽk SSAO (hI)
-    void Blur();
+    // Resolution divisor + sample count, the kernel is regenerated and uploaded once
+    void SetQuality(int resolutionDivisor, int kernelSize);
 
     // o̲׵GK ID
-    unsigned int GetSSAOTexture() { return ssaoColorBufferBlur; }
+    unsigned int GetSSAOTexture() { return ssaoBlurTarget ? ssaoBlurTarget->texture : 0; }
+    // Hands the AO target back to the pool, after the lighting pass read it
+    void Release();
+    void Resize(int w, int h) { width = w; height = h; }
 
 private:
+    int getAOWidth() const { return std::max(width / resolutionDivisor, 1); }
+    int getAOHeight() const { return std::max(height / resolutionDivisor, 1); }
+    uint32_t getVariant(bool compact) const;
+
     void generateKernel();
     void generateNoiseTexture();
     float lerp(float a, float b, float f);
@@ -45,7 +45,7 @@ float skyboxVertices[] = {
      1.0f, -1.0f,  1.0f
 };
 
-SkyboxRenderer::SkyboxRenderer() {
+SkyboxRenderer::SkyboxRenderer(TextureStreamer* streamer) {
     skyboxShader = new Shader("assets/shaders/skybox.vert", "assets/shaders/skybox.frag");
 
     glGenVertexArrays(1, &skyboxVAO);
@@ -64,7 +64,7 @@ SkyboxRenderer::SkyboxRenderer() {
         "assets/textures/skybox/front.jpg",
         "assets/textures/skybox/back.jpg"
     };
-    cubemapTexture = loadCubemap(faces);
+    cubemap = streamer->LoadCubemap(faces, glm::vec4(0.05f, 0.05f, 0.1f, 1.0f)); // dark sky until the faces arrive
 
     skyboxShader->use();
     skyboxShader->setInt("skybox", 0);
@@ -90,36 +90,9 @@ void SkyboxRenderer::Draw(Camera& camera) {
 
     glBindVertexArray(skyboxVAO);
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap->texture);
     glDrawArrays(GL_TRIANGLES, 0, 36);
     glBindVertexArray(0);
 
     glDepthFunc(GL_LESS);
 }
-
-unsigned int SkyboxRenderer::loadCubemap(std::vector<std::string> faces) {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-    int width, height, nrChannels;
-    for (unsigned int i = 0; i < faces.size(); i++) {
-        unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data) {
-            // RGBA
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
-        }
-        else {
-            std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
-        }
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-    return textureID;
-}
\ No newline at end of file
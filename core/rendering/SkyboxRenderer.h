@@ -5,20 +5,16 @@
 #include <iostream>
 #include "../Shader.h"
 #include "../Camera.h"
-#include "../Texture.h"
-#include "stb_image.h"
+#include "TextureStreamer.h"
 #include <glm/gtc/type_ptr.hpp>
 
 class SkyboxRenderer {
 public:
     unsigned int skyboxVAO, skyboxVBO;
-    unsigned int cubemapTexture;
+    StreamedTexture* cubemap; // owned by the streamer
     Shader* skyboxShader;
 
-    SkyboxRenderer();
+    SkyboxRenderer(TextureStreamer* streamer);
     ~SkyboxRenderer();
     void Draw(Camera& camera);
-
-private:
-    unsigned int loadCubemap(std::vector<std::string> faces);
 };
\ No newline at end of file
@@ -0,0 +1,204 @@
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "stb_image.h"
+
+static GLenum formatOf(int channels) {
+    return channels == 1 ? GL_RED : channels == 2 ? GL_RG : channels == 3 ? GL_RGB : GL_RGBA;
+}
+
+static GLenum internalFormatOf(int channels) {
+    return channels == 1 ? GL_R8 : channels == 2 ? GL_RG8 : channels == 3 ? GL_RGB8 : GL_RGBA8;
+}
+
+TextureStreamer::TextureStreamer(unsigned int decodeThreads, size_t uploadBudget) : pendingCount(0) {
+    decodePool = new ThreadPool(decodeThreads);
+    staging = new PersistentRingBuffer(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)uploadBudget, 4);
+}
+
+TextureStreamer::~TextureStreamer() {
+    delete decodePool; // finishes the queued decodes
+
+    std::deque<Request*> requests = uploads;
+    requests.insert(requests.end(), decoded.begin(), decoded.end());
+    for (Request* request : requests) {
+        for (unsigned char* pixels : request->pixels) stbi_image_free(pixels);
+        if (request->texture) glDeleteTextures(1, &request->texture);
+        delete request;
+    }
+    for (StreamedTexture* texture : textures) {
+        glDeleteTextures(1, &texture->texture);
+        delete texture;
+    }
+    delete staging;
+}
+
+StreamedTexture* TextureStreamer::Load2D(const std::string& path, const glm::vec4& placeholder) {
+    return request(GL_TEXTURE_2D, std::vector<std::string>(1, path), 0, placeholder);
+}
+
+StreamedTexture* TextureStreamer::LoadCubemap(const std::vector<std::string>& faces, const glm::vec4& placeholder) {
+    return request(GL_TEXTURE_CUBE_MAP, faces, 4, placeholder);
+}
+
+StreamedTexture* TextureStreamer::request(GLenum target, const std::vector<std::string>& paths, int desiredChannels, const glm::vec4& placeholder) {
+    // 1. placeholder: 1x1, every layer the same color
+    StreamedTexture* result = new StreamedTexture{ 0, target, false, 1, 1 };
+    glm::u8vec4 color = glm::u8vec4(glm::clamp(placeholder, 0.0f, 1.0f) * 255.0f + 0.5f);
+    glCreateTextures(target, 1, &result->texture);
+    glTextureStorage2D(result->texture, 1, GL_RGBA8, 1, 1);
+    if (target == GL_TEXTURE_CUBE_MAP) {
+        for (int face = 0; face < 6; face++)
+            glTextureSubImage3D(result->texture, 0, 0, 0, face, 1, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &color.x);
+    }
+    else {
+        glTextureSubImage2D(result->texture, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &color.x);
+    }
+    textures.push_back(result);
+
+    // 2. one decode job per layer, the last one to finish queues the upload
+    Request* request = new Request();
+    request->result = result;
+    request->paths = paths;
+    request->pixels.assign(paths.size(), nullptr);
+    request->sizes.assign(paths.size(), glm::ivec3(0));
+    request->desiredChannels = desiredChannels;
+    request->decodedLayers = 0;
+    request->texture = 0;
+    request->layer = 0;
+    request->row = 0;
+    pendingCount++;
+
+    for (size_t i = 0; i < paths.size(); i++) {
+        decodePool->Submit([this, request, i]() {
+            glm::ivec3& size = request->sizes[i];
+            request->pixels[i] = stbi_load(request->paths[i].c_str(), &size.x, &size.y, &size.z, request->desiredChannels);
+            if (request->desiredChannels != 0) size.z = request->desiredChannels;
+            if (++request->decodedLayers == (int)request->paths.size()) {
+                std::lock_guard<std::mutex> lock(mutex);
+                decoded.push_back(request);
+            }
+        });
+    }
+    return result;
+}
+
+// All layers decoded: checks them and allocates the final (immutable) texture
+bool TextureStreamer::beginUpload(Request* request) {
+    glm::ivec3 size = request->sizes[0];
+    for (size_t i = 0; i < request->paths.size(); i++) {
+        if (request->pixels[i] == nullptr) {
+            std::cout << "Texture failed to load at path: " << request->paths[i] << std::endl;
+            return false;
+        }
+        if (request->sizes[i] != size) {
+            std::cout << "Texture layers differ in size / channels: " << request->paths[i] << std::endl;
+            return false;
+        }
+    }
+
+    GLenum target = request->result->target;
+    GLsizei levels = 1;
+    if (target == GL_TEXTURE_2D)
+        while ((std::max(size.x, size.y) >> levels) > 0) levels++;
+
+    glCreateTextures(target, 1, &request->texture);
+    glTextureStorage2D(request->texture, levels, internalFormatOf(size.z), size.x, size.y);
+    if (target == GL_TEXTURE_2D) {
+        glTextureParameteri(request->texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTextureParameteri(request->texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTextureParameteri(request->texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    }
+    else {
+        glTextureParameteri(request->texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(request->texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(request->texture, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(request->texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    }
+    glTextureParameteri(request->texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    return true;
+}
+
+void TextureStreamer::finishUpload(Request* request, bool success) {
+    StreamedTexture* result = request->result;
+    if (success) {
+        if (result->target == GL_TEXTURE_2D) glGenerateTextureMipmap(request->texture);
+        // swap: draws already submitted keep the placeholder alive until they are done
+        glDeleteTextures(1, &result->texture);
+        result->texture = request->texture;
+        result->width = request->sizes[0].x;
+        result->height = request->sizes[0].y;
+        result->resident = true;
+    }
+    else if (request->texture) {
+        glDeleteTextures(1, &request->texture); // keeps the placeholder
+    }
+
+    for (unsigned char* pixels : request->pixels) stbi_image_free(pixels);
+    delete request;
+    pendingCount--;
+}
+
+void TextureStreamer::Update() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        uploads.insert(uploads.end(), decoded.begin(), decoded.end());
+        decoded.clear();
+    }
+    if (uploads.empty()) return;
+
+    // 1. this frame's staging region (its previous upload was 3 frames ago, the fence is long signaled)
+    unsigned char* region = staging->Map();
+    GLsizeiptr used = 0;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging->buffer);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    // 2. whole rows until the budget is used up, a texture may continue next frame
+    while (!uploads.empty()) {
+        Request* request = uploads.front();
+        if (request->texture == 0 && !beginUpload(request)) {
+            uploads.pop_front();
+            finishUpload(request, false);
+            continue;
+        }
+
+        glm::ivec3 size = request->sizes[0];
+        GLsizeiptr rowBytes = (GLsizeiptr)size.x * size.z;
+        int rows = (int)std::min<GLsizeiptr>(size.y - request->row, (staging->regionSize - used) / rowBytes);
+        if (rows == 0) {
+            if (used > 0) break; // next frame
+            std::cout << "Texture row exceeds the upload budget: " << request->paths[0] << std::endl;
+            uploads.pop_front();
+            finishUpload(request, false);
+            continue;
+        }
+
+        memcpy(region + used, request->pixels[request->layer] + rowBytes * request->row, rowBytes * rows);
+        const void* offset = (const void*)(staging->GetRegionOffset() + used);
+        if (request->result->target == GL_TEXTURE_CUBE_MAP)
+            glTextureSubImage3D(request->texture, 0, 0, request->row, request->layer, size.x, rows, 1, formatOf(size.z), GL_UNSIGNED_BYTE, offset);
+        else
+            glTextureSubImage2D(request->texture, 0, 0, request->row, size.x, rows, formatOf(size.z), GL_UNSIGNED_BYTE, offset);
+        used += rowBytes * rows;
+
+        request->row += rows;
+        if (request->row < size.y) continue;
+        request->row = 0;
+        if (++request->layer < (int)request->paths.size()) continue;
+        uploads.pop_front();
+        finishUpload(request, true);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    staging->EndFrame();
+}
+
+void TextureStreamer::Flush() {
+    while (pendingCount > 0) {
+        Update();
+        std::this_thread::yield();
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../ThreadPool.h"
+#include "PersistentRingBuffer.h"
+
+// Handed out by TextureStreamer right away. `texture` is a 1x1 placeholder until the image is
+// resident, then it names the real texture: read it when binding, don't keep a copy.
+struct StreamedTexture {
+    unsigned int texture;
+    GLenum target; // GL_TEXTURE_2D / GL_TEXTURE_CUBE_MAP
+    bool resident;
+    int width, height;
+};
+
+// Asynchronous texture loading. stb_image decodes on a worker pool of its own (decode jobs are long,
+// they would hold up the per-frame ParallelFor work of the shared pool). Update() copies decoded rows
+// into a persistently mapped pixel unpack buffer ring, at most uploadBudget bytes per frame, so a large
+// image is spread over several frames; the real texture replaces the placeholder once it is complete.
+class TextureStreamer {
+public:
+    TextureStreamer(unsigned int decodeThreads = 2, size_t uploadBudget = 4 << 20);
+    ~TextureStreamer();
+
+    // Mipmapped, repeating 2D texture (channel count of the file)
+    StreamedTexture* Load2D(const std::string& path, const glm::vec4& placeholder = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+    // RGBA cubemap, faces in +X -X +Y -Y +Z -Z order
+    StreamedTexture* LoadCubemap(const std::vector<std::string>& faces, const glm::vec4& placeholder = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+
+    // GL thread, once per frame: uploads within the budget, swaps in completed textures
+    void Update();
+    // Blocks until every requested texture is resident (benchmarks)
+    void Flush();
+    int GetPendingCount() const { return pendingCount; }
+
+private:
+    struct Request {
+        StreamedTexture* result;
+        std::vector<std::string> paths; // one per layer (cubemap: 6 faces)
+        std::vector<unsigned char*> pixels;
+        std::vector<glm::ivec3> sizes; // width, height, channels per layer
+        int desiredChannels;           // 0: as stored
+        std::atomic<int> decodedLayers;
+
+        // upload progress (GL thread)
+        unsigned int texture;
+        int layer, row;
+    };
+
+    ThreadPool* decodePool;
+    PersistentRingBuffer* staging; // one region per frame in flight
+    std::vector<StreamedTexture*> textures;
+    std::atomic<int> pendingCount;
+
+    std::mutex mutex;
+    std::deque<Request*> decoded; // mutex, filled by the decode jobs
+    std::deque<Request*> uploads; // GL thread
+
+    StreamedTexture* request(GLenum target, const std::vector<std::string>& paths, int desiredChannels, const glm::vec4& placeholder);
+    bool beginUpload(Request* request);
+    void finishUpload(Request* request, bool success);
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "../Shader.h"
+
+// Low resolution froxel volume for height fog + light scattering.
+// Inject (per froxel) -> integrate front to back (per column) once per frame,
+// the lighting pass then needs a single 3D texture fetch per pixel.
+// Uses the light / cluster SSBOs bound by the renderer.
+class VolumetricFog {
+public:
+    unsigned int scatterVolume;    // RGBA16F: in-scattering, extinction
+    unsigned int integratedVolume; // RGBA16F: accumulated in-scattering, transmittance
+    int sizeX, sizeY, sizeZ;
+
+    float scatteringIntensity;
+    float anisotropy;
+
+    Shader* injectShader;
+    Shader* integrateShader;
+
+    VolumetricFog(int x = 160, int y = 90, int z = 64);
+    ~VolumetricFog();
+
+    // Readers sampling the volume need a GL_TEXTURE_FETCH_BARRIER_BIT first
+    void Compute(const glm::mat4& view, const glm::vec3& viewPos, float fovY, float aspect, float zNear, float zFar);
+
+    unsigned int GetVolumeTexture() { return integratedVolume; }
+
+private:
+    unsigned int createVolume();
+};
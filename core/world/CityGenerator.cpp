@@ -0,0 +1,108 @@
+#include "CityGenerator.h"
+#include "../ThreadPool.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+uint32_t CityGenerator::ChunkSeed(uint32_t worldSeed, int chunkX, int chunkZ) {
+    // splitmix-style mixing, neighbouring chunks get unrelated seeds
+    uint64_t h = worldSeed;
+    h ^= (uint64_t)(uint32_t)chunkX * 0x9E3779B97F4A7C15ull;
+    h ^= (uint64_t)(uint32_t)chunkZ * 0xC2B2AE3D27D4EB4Full;
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+    return (uint32_t)(h ^ (h >> 31));
+}
+
+void CityGenerator::GenerateChunk(uint32_t worldSeed, int chunkX, int chunkZ,
+    std::vector<CompactInstance>& instances, glm::vec3& boundsMin, glm::vec3& boundsMax) {
+    // raw engine output only: mt19937 is specified by the standard, the distributions are not
+    std::mt19937 rng(ChunkSeed(worldSeed, chunkX, chunkZ));
+
+    instances.clear();
+    boundsMin = glm::vec3(1e30f);
+    boundsMax = glm::vec3(-1e30f);
+
+    for (int i = 0; i < CHUNK_BLOCKS; i++) {
+        for (int j = 0; j < CHUNK_BLOCKS; j++) {
+            int x = chunkX * CHUNK_BLOCKS + i;
+            int z = chunkZ * CHUNK_BLOCKS + j;
+
+            // random height (same distribution as the original city)
+            float height = static_cast<float>(rng() % 5 + 1);
+            if (rng() % 100 > 90) height *= 4.0f;
+            if (rng() % 100 > 95) height *= 2.0f;
+
+            // camera reserved
+            if (abs(x) < 2 && abs(z) < 2) continue;
+
+            CompactInstance building;
+            building.Position = glm::vec3(x * BLOCK_SPACING, height / 2.0f, z * BLOCK_SPACING);
+            building.Material = rng();
+            building.Scale = glm::vec3(2.0f, height, 2.0f);
+            building.pad = 0.0f;
+            instances.push_back(building);
+
+            boundsMin = glm::min(boundsMin, building.Position - 0.5f * building.Scale);
+            boundsMax = glm::max(boundsMax, building.Position + 0.5f * building.Scale);
+        }
+    }
+}
+
+bool CityGenerator::RunDeterminismTest() {
+    const uint32_t WORLD_SEED = 999;
+    const int RANGE = 8; // chunks -8..7 on both axes
+    const int CHUNKS = (2 * RANGE) * (2 * RANGE);
+
+    auto generateAll = [&](unsigned int threads, bool reverse) {
+        std::vector<std::vector<CompactInstance>> chunks(CHUNKS);
+        ThreadPool pool(threads);
+        pool.ParallelFor(CHUNKS, 1, [&](size_t begin, size_t end) {
+            for (size_t n = begin; n < end; n++) {
+                size_t c = reverse ? CHUNKS - 1 - n : n;
+                glm::vec3 bMin, bMax;
+                GenerateChunk(WORLD_SEED, (int)(c % (2 * RANGE)) - RANGE, (int)(c / (2 * RANGE)) - RANGE, chunks[c], bMin, bMax);
+            }
+        });
+        return chunks;
+    };
+
+    auto same = [](const std::vector<std::vector<CompactInstance>>& a, const std::vector<std::vector<CompactInstance>>& b) {
+        for (size_t c = 0; c < a.size(); c++) {
+            if (a[c].size() != b[c].size()) return false;
+            if (!a[c].empty() && memcmp(a[c].data(), b[c].data(), a[c].size() * sizeof(CompactInstance)) != 0) return false;
+        }
+        return true;
+    };
+
+    std::cout << "City generation determinism test, " << CHUNKS << " chunks" << std::endl;
+    std::vector<std::vector<CompactInstance>> reference = generateAll(1, false);
+    size_t buildings = 0;
+    for (const auto& chunk : reference) buildings += chunk.size();
+
+    bool passed = true;
+    const unsigned int threadCounts[] = { 1, 2, 4, 8 };
+    for (unsigned int threads : threadCounts) {
+        for (int reverse = 0; reverse < 2; reverse++) {
+            bool ok = same(reference, generateAll(threads, reverse != 0));
+            if (!ok) passed = false;
+            std::cout << "  " << threads << " worker(s)" << (reverse ? ", reverse order" : "") << ": "
+                      << (ok ? "identical" : "DIFFERENT") << std::endl;
+        }
+    }
+
+    // neighbouring chunks must not repeat each other
+    glm::vec3 bMin, bMax;
+    std::vector<CompactInstance> a, b;
+    GenerateChunk(WORLD_SEED, 3, 3, a, bMin, bMax);
+    GenerateChunk(WORLD_SEED, 4, 3, b, bMin, bMax);
+    bool distinct = false;
+    for (size_t i = 0; i < a.size() && i < b.size(); i++)
+        if (a[i].Scale.y != b[i].Scale.y) distinct = true;
+    if (!distinct) passed = false;
+    std::cout << "  neighbour chunks " << (distinct ? "differ" : "REPEAT") << ", " << buildings << " buildings" << std::endl;
+
+    std::cout << (passed ? "PASSED" : "FAILED") << std::endl;
+    return passed;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "../rendering/InstancedMesh.h"
+
+// Deterministic city chunks. Every chunk gets its own mt19937 seeded from
+// (worldSeed, chunk x, chunk z), so its content does not depend on which
+// thread builds it or in which order chunks are requested. No GL calls.
+class CityGenerator {
+public:
+    static const int CHUNK_BLOCKS = 16;     // blocks per chunk side
+    static const int MAX_CHUNK_INSTANCES = CHUNK_BLOCKS * CHUNK_BLOCKS;
+    static constexpr float BLOCK_SPACING = 3.0f;
+    static constexpr float CHUNK_SIZE = CHUNK_BLOCKS * BLOCK_SPACING;
+
+    static uint32_t ChunkSeed(uint32_t worldSeed, int chunkX, int chunkZ);
+    // Buildings of one chunk (at most MAX_CHUNK_INSTANCES), also returns its world bounds
+    static void GenerateChunk(uint32_t worldSeed, int chunkX, int chunkZ,
+        std::vector<CompactInstance>& instances, glm::vec3& boundsMin, glm::vec3& boundsMax);
+
+    // Generates a block of chunks with 1, 2, 4 and 8 threads and in reverse order,
+    // returns false if any result differs (no GL needed)
+    static bool RunDeterminismTest();
+};
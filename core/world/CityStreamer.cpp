@@ -0,0 +1,156 @@
+#include "CityStreamer.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+CityStreamer::CityStreamer(ThreadPool* pool, uint32_t worldSeed, int loadRadius)
+    : loadRadius(loadRadius), maxUploadsPerFrame(8), residentChunks(0), pendingChunks(0), drawnChunks(0), drawnInstances(0),
+      pool(pool), worldSeed(worldSeed), nextRequestId(0), inFlight(0) {
+    // chunks are dropped one ring outside the load radius
+    int side = 2 * (loadRadius + 1) + 1;
+    slotCount = (unsigned int)(side * side);
+    for (int i = (int)slotCount - 1; i >= 0; i--) freeSlots.push_back(i);
+
+    mesh = MeshBuffer::CreateCube();
+
+    glGenBuffers(1, &instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferStorage(GL_ARRAY_BUFFER, (GLsizeiptr)slotCount * CityGenerator::MAX_CHUNK_INSTANCES * sizeof(CompactInstance), NULL, GL_DYNAMIC_STORAGE_BIT);
+
+    mesh->Bind();
+    InstancedMesh::SetupInstanceAttributes(InstanceLayout::Compact);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &indirectBuffer);
+}
+
+CityStreamer::~CityStreamer() {
+    // jobs write into `completed`, let them finish first
+    while (inFlight.load() > 0) std::this_thread::yield();
+
+    delete mesh;
+    glDeleteBuffers(1, &instanceBuffer);
+    glDeleteBuffers(1, &indirectBuffer);
+}
+
+void CityStreamer::request(int x, int z) {
+    Chunk chunk;
+    chunk.slot = -1;
+    chunk.instanceCount = 0;
+    chunk.requestId = nextRequestId++;
+    chunks[std::make_pair(x, z)] = chunk;
+
+    unsigned int requestId = chunk.requestId;
+    inFlight++;
+    pool->Submit([this, x, z, requestId]() {
+        GeneratedChunk generated;
+        generated.x = x;
+        generated.z = z;
+        generated.requestId = requestId;
+        CityGenerator::GenerateChunk(worldSeed, x, z, generated.instances, generated.boundsMin, generated.boundsMax);
+        {
+            std::lock_guard<std::mutex> lock(completedMutex);
+            completed.push_back(std::move(generated));
+        }
+        inFlight--;
+    });
+}
+
+void CityStreamer::upload(GeneratedChunk& generated) {
+    auto it = chunks.find(std::make_pair(generated.x, generated.z));
+    if (it == chunks.end()) return; // unloaded while it was generating
+    // stale result of an earlier request (dropped and requested again while generating)
+    if (it->second.requestId != generated.requestId || it->second.slot >= 0) return;
+    if (freeSlots.empty()) {
+        chunks.erase(it); // cannot happen: at most slotCount chunks are kept and each holds at most one slot
+        return;
+    }
+
+    Chunk& chunk = it->second;
+    chunk.slot = freeSlots.back();
+    freeSlots.pop_back();
+    chunk.instanceCount = (unsigned int)generated.instances.size();
+    chunk.boundsMin = generated.boundsMin;
+    chunk.boundsMax = generated.boundsMax;
+
+    GLintptr offset = (GLintptr)chunk.slot * CityGenerator::MAX_CHUNK_INSTANCES * sizeof(CompactInstance);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferSubData(GL_ARRAY_BUFFER, offset, chunk.instanceCount * sizeof(CompactInstance), generated.instances.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void CityStreamer::Update(const glm::vec3& cameraPos) {
+    int camX = (int)std::floor((cameraPos.x + 0.5f * CityGenerator::BLOCK_SPACING) / CityGenerator::CHUNK_SIZE);
+    int camZ = (int)std::floor((cameraPos.z + 0.5f * CityGenerator::BLOCK_SPACING) / CityGenerator::CHUNK_SIZE);
+
+    // 1. drop chunks outside the hysteresis ring (in-flight ones are dropped when they arrive)
+    for (auto it = chunks.begin(); it != chunks.end();) {
+        int dx = std::abs(it->first.first - camX), dz = std::abs(it->first.second - camZ);
+        if (dx > loadRadius + 1 || dz > loadRadius + 1) {
+            if (it->second.slot >= 0) freeSlots.push_back(it->second.slot);
+            it = chunks.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    // 2. request missing chunks, nearest first
+    std::vector<std::pair<int, std::pair<int, int>>> missing;
+    for (int z = camZ - loadRadius; z <= camZ + loadRadius; z++)
+        for (int x = camX - loadRadius; x <= camX + loadRadius; x++)
+            if (chunks.find(std::make_pair(x, z)) == chunks.end())
+                missing.push_back(std::make_pair((x - camX) * (x - camX) + (z - camZ) * (z - camZ), std::make_pair(x, z)));
+    std::sort(missing.begin(), missing.end());
+    for (const auto& m : missing) request(m.second.first, m.second.second);
+
+    // 3. upload a few finished chunks
+    for (unsigned int n = 0; n < maxUploadsPerFrame; n++) {
+        GeneratedChunk generated;
+        {
+            std::lock_guard<std::mutex> lock(completedMutex);
+            if (completed.empty()) break;
+            generated = std::move(completed.front());
+            completed.pop_front();
+        }
+        upload(generated);
+    }
+
+    residentChunks = 0;
+    pendingChunks = 0;
+    for (const auto& it : chunks) {
+        if (it.second.slot >= 0) residentChunks++;
+        else pendingChunks++;
+    }
+}
+
+void CityStreamer::Draw(const Frustum& frustum) {
+    commands.clear();
+    drawnInstances = 0;
+    for (const auto& it : chunks) {
+        const Chunk& chunk = it.second;
+        if (chunk.slot < 0 || chunk.instanceCount == 0) continue;
+
+        glm::vec3 center = 0.5f * (chunk.boundsMin + chunk.boundsMax);
+        glm::vec3 extent = 0.5f * (chunk.boundsMax - chunk.boundsMin);
+        if (!frustum.IntersectsAABB(center, extent)) continue;
+
+        // baseInstance selects the chunk's slot in the instance buffer
+        DrawElementsIndirectCommand command = { (uint32_t)mesh->indexCount, chunk.instanceCount, 0, 0,
+            (uint32_t)(chunk.slot * CityGenerator::MAX_CHUNK_INSTANCES) };
+        commands.push_back(command);
+        drawnInstances += chunk.instanceCount;
+    }
+    drawnChunks = (unsigned int)commands.size();
+    if (commands.empty()) return;
+
+    // orphan + refill
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STREAM_DRAW);
+
+    mesh->Bind();
+    glMultiDrawElementsIndirect(GL_TRIANGLES, mesh->indexType, 0, (GLsizei)commands.size(), 0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "CityGenerator.h"
+#include "../Frustum.h"
+#include "../ThreadPool.h"
+#include "../rendering/InstancedMesh.h"
+#include "../rendering/MeshBuffer.h"
+
+// Streams city chunks around the camera.
+// Chunks are generated on the thread pool, uploaded into a fixed pool of GPU slots
+// (MAX_CHUNK_INSTANCES compact instances each) and drawn with one indirect command
+// per visible chunk. Memory use is fixed by the load radius.
+class CityStreamer {
+public:
+    int loadRadius;           // chunks kept around the camera chunk
+    unsigned int slotCount;   // GPU slots, enough for the unload hysteresis ring
+    unsigned int maxUploadsPerFrame;
+
+    // stats of the last Update() / Draw()
+    unsigned int residentChunks, pendingChunks, drawnChunks, drawnInstances;
+
+    CityStreamer(ThreadPool* pool, uint32_t worldSeed = 999, int loadRadius = 3);
+    ~CityStreamer();
+
+    // Request / drop chunks around the camera and upload finished ones (never blocks)
+    void Update(const glm::vec3& cameraPos);
+    // Frustum-cull resident chunks and draw them (G-buffer compact shader must be bound)
+    void Draw(const Frustum& frustum);
+
+private:
+    struct Chunk {
+        int slot;               // -1 while generating
+        unsigned int requestId; // matches the GeneratedChunk of the current request
+        unsigned int instanceCount;
+        glm::vec3 boundsMin, boundsMax;
+    };
+    struct GeneratedChunk {
+        int x, z;
+        unsigned int requestId;
+        std::vector<CompactInstance> instances;
+        glm::vec3 boundsMin, boundsMax;
+    };
+
+    ThreadPool* pool;
+    uint32_t worldSeed;
+
+    MeshBuffer* mesh;
+    unsigned int instanceBuffer; // slotCount * MAX_CHUNK_INSTANCES CompactInstances
+    unsigned int indirectBuffer;
+
+    std::map<std::pair<int, int>, Chunk> chunks; // resident + in flight
+    std::vector<int> freeSlots;
+    unsigned int nextRequestId; // a chunk dropped and requested again while generating gets two results
+    std::vector<DrawElementsIndirectCommand> commands;
+
+    // worker -> main thread hand-off
+    std::mutex completedMutex;
+    std::deque<GeneratedChunk> completed;
+    std::atomic<int> inFlight;
+
+    void request(int x, int z);
+    void upload(GeneratedChunk& generated);
+};
@@ -5,14 +5,28 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
 
 #include "core/Shader.h"
+#include "core/ShaderCache.h"
+#include "core/ShaderHotReload.h"
 #include "core/Camera.h"
 #include "core/GBuffer.h"
 #include "core/rendering/DeferredRenderer.h"
 #include "core/rendering/Primitives.h"
 #include "core/rendering/InstancedMesh.h"
 #include "core/rendering/SkyboxRenderer.h"
+#include "core/rendering/LightSystem.h"
+#include "core/rendering/OcclusionCuller.h"
+#include "core/rendering/GpuTimer.h"
+#include "core/ThreadPool.h"
+#include "core/Frustum.h"
+#include "core/world/CityGenerator.h"
+#include "core/world/CityStreamer.h"
 
 extern "C" {
     __declspec(dllexport) unsigned long NvOptimusEnablement = 0x00000001;
@@ -31,23 +45,383 @@ float lastFrame = 0.0f;
 
 // �����]�w
 const unsigned int NR_LIGHTS = 200;
-std::vector<glm::vec3> lightPositions;
-std::vector<glm::vec3> lightColors;
 InstancedMesh* cityMesh;
+InstancedMesh* trafficMesh; // dynamic instances, rewritten every frame
+CityStreamer* cityStreamer;
 SkyboxRenderer* skybox;
+DeferredRenderer* rendererPtr = nullptr;
+bool gpuCulling = false; // G: cull buildings in a compute shader + indirect draw
+bool occlusionCulling = true; // O: CPU software occlusion culling (CPU culling path only)
+bool streamedCity = true; // C: streamed chunk city <-> fixed 40x40 city
 
 // Callback �ŧi
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void processInput(GLFWwindow* window);
 
-int main()
+// Building grid of (2 * citySize)^2 blocks, heights from rand()
+void generateCity(int citySize, std::vector<CompactInstance>& instances) {
+    float SPACING = 3.0f; // building spacing
+
+    for (int x = -citySize; x < citySize; x++) {
+        for (int z = -citySize; z < citySize; z++) {
+            // camera reserved
+            if (abs(x) < 2 && abs(z) < 2) continue;
+
+            float posX = x * SPACING;
+            float posZ = z * SPACING;
+
+            // random height
+            float height = static_cast<float>(rand() % 5 + 1);
+            if (rand() % 100 > 90) height *= 4.0f;
+            if (rand() % 100 > 95) height *= 2.0f;
+
+            CompactInstance building;
+            building.Position = glm::vec3(posX, height / 2.0f, posZ);
+            building.Material = (uint32_t)(x * 73856093) ^ (uint32_t)(z * 19349663); // per-block seed
+            building.Scale = glm::vec3(2.0f, height, 2.0f);
+            building.pad = 0.0f;
+            instances.push_back(building);
+        }
+    }
+}
+
+// Cars driving along the streets between the blocks, wrapping around at +-TRAFFIC_EXTENT
+const unsigned int NR_VEHICLES = 4000;
+const float TRAFFIC_EXTENT = 120.0f;
+
+struct Vehicle {
+    glm::vec3 lane;      // point on the lane, its coordinate along `direction` is ignored
+    glm::vec3 direction; // +-x or +-z
+    float speed;
+    float offset;        // start position along the lane
+};
+
+void generateTraffic(unsigned int count, std::vector<Vehicle>& vehicles, std::vector<CompactInstance>& instances) {
+    float SPACING = 3.0f; // same grid as the city, streets run halfway between blocks
+    int streets = (int)(TRAFFIC_EXTENT / SPACING);
+
+    for (unsigned int i = 0; i < count; i++) {
+        Vehicle vehicle;
+        float street = ((rand() % (2 * streets)) - streets + 0.5f) * SPACING;
+        float side = (rand() % 2) ? 1.0f : -1.0f; // one lane per direction
+        bool alongX = rand() % 2 == 0;
+        vehicle.direction = alongX ? glm::vec3(side, 0.0f, 0.0f) : glm::vec3(0.0f, 0.0f, side);
+        vehicle.lane = alongX ? glm::vec3(0.0f, 0.1f, street + 0.2f * side) : glm::vec3(street - 0.2f * side, 0.1f, 0.0f);
+        vehicle.speed = 4.0f + (rand() % 100) * 0.04f;
+        vehicle.offset = (rand() % 1000) * 0.001f * 2.0f * TRAFFIC_EXTENT;
+        vehicles.push_back(vehicle);
+
+        CompactInstance car;
+        car.Position = vehicle.lane;
+        car.Material = i;
+        car.Scale = alongX ? glm::vec3(0.6f, 0.2f, 0.3f) : glm::vec3(0.3f, 0.2f, 0.6f);
+        car.pad = 0.0f;
+        instances.push_back(car);
+    }
+}
+
+void updateTraffic(float time, const std::vector<Vehicle>& vehicles, std::vector<CompactInstance>& instances) {
+    for (size_t i = 0; i < vehicles.size(); i++) {
+        const Vehicle& vehicle = vehicles[i];
+        float along = std::fmod(vehicle.offset + vehicle.speed * time, 2.0f * TRAFFIC_EXTENT) - TRAFFIC_EXTENT;
+        glm::vec3 axis = glm::abs(vehicle.direction);
+        instances[i].Position = vehicle.lane * (glm::vec3(1.0f) - axis) + vehicle.direction * along;
+    }
+}
+
+// --bench-instances: vertex-stage cost and instance buffer size, mat4 vs compact layout
+void runInstanceBenchmark(DeferredRenderer& renderer, int citySize) {
+    std::vector<CompactInstance> compact;
+    generateCity(citySize, compact);
+    std::vector<glm::mat4> matrices;
+    for (const CompactInstance& building : compact) matrices.push_back(building.ToMatrix());
+
+    InstancedMesh matrixMesh(matrices);
+    InstancedMesh compactMesh(compact);
+
+    // overview camera with the whole city in view
+    float cityExtent = citySize * 3.0f;
+    Camera overview(glm::vec3(0.0f, cityExtent, cityExtent * 1.5f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, -35.0f);
+    renderer.farPlane = cityExtent * 4.0f;
+
+    GpuTimer timer;
+    const int WARMUP = 10, FRAMES = 100;
+    auto measure = [&](InstancedMesh& mesh, bool vertexOnly) {
+        if (vertexOnly) glEnable(GL_RASTERIZER_DISCARD); // no fragments: vertex fetch + shading only
+        double total = 0.0;
+        for (int i = 0; i < WARMUP + FRAMES; i++) {
+            renderer.BeginGeometryPass(overview);
+            renderer.GetGeometryShader(mesh.layout)->use();
+            timer.Begin();
+            mesh.Draw();
+            timer.End();
+            double ms = timer.Finish();
+            if (i >= WARMUP) total += ms;
+        }
+        renderer.EndGeometryPass();
+        glDisable(GL_RASTERIZER_DISCARD);
+        return total / FRAMES;
+    };
+
+    std::cout << "Instance layout benchmark, " << compact.size() << " buildings, " << FRAMES << " frames" << std::endl;
+    InstancedMesh* meshes[2] = { &matrixMesh, &compactMesh };
+    const char* names[2] = { "mat4   ", "compact" };
+    for (int i = 0; i < 2; i++) {
+        double vertexMs = measure(*meshes[i], true);
+        double fullMs = measure(*meshes[i], false);
+        std::cout << "  " << names[i] << ": " << meshes[i]->instanceStride << " B / instance, "
+                  << meshes[i]->GetInstanceBufferSize() / 1024 << " KB buffer, vertex stage " << vertexMs
+                  << " ms, full G-buffer " << fullMs << " ms" << std::endl;
+    }
+}
+
+// --bench-gbuffer: bytes per pixel and pass times, standard vs compact G-buffer layout
+void runGBufferBenchmark(DeferredRenderer& renderer, int citySize) {
+    std::vector<CompactInstance> buildings;
+    generateCity(citySize, buildings);
+    InstancedMesh city(buildings);
+
+    ThreadPool pool;
+    LightSystem lights(&pool);
+    for (unsigned int i = 0; i < NR_LIGHTS; i++) lights.Add(glm::vec3(0.0f, 10.0f, 10.0f));
+
+    // street-level camera, buildings cover most of the screen
+    Camera street(glm::vec3(0.0f, 5.0f, 15.0f));
+
+    const int WARMUP = 10, FRAMES = 100;
+    std::cout << "G-buffer layout benchmark, " << renderer.width << "x" << renderer.height << ", " << FRAMES << " frames" << std::endl;
+
+    GBufferLayout layouts[2] = { GBufferLayout::Standard, GBufferLayout::Compact };
+    const char* names[2] = { "standard", "compact " };
+    for (int l = 0; l < 2; l++) {
+        renderer.SetGBufferLayout(layouts[l]);
+        double geometryMs = 0.0, lightingMs = 0.0;
+        for (int i = 0; i < WARMUP + FRAMES; i++) {
+            lights.Update(i * 0.016f, renderer.lightBuffer->Map(), renderer.lightBuffer->capacity);
+
+            renderer.UploadLights(lights, street);
+            renderer.RenderFrame(street, [&]() {
+                renderer.GetGeometryShader(city.layout)->use();
+                city.Draw();
+            }, []() {});
+
+            // SSAO + fog + full-screen lighting, everything that reads the G-buffer
+            const FrameGraph& graph = *renderer.frameGraph;
+            double lit = graph.GetPassMilliseconds("SSAO") + graph.GetPassMilliseconds("VolumetricFog") + graph.GetPassMilliseconds("Lighting");
+            if (i >= WARMUP) { geometryMs += graph.GetPassMilliseconds("Geometry"); lightingMs += lit; }
+        }
+        int bytes = GBuffer::GetBytesPerPixel(layouts[l]);
+        std::cout << "  " << names[l] << ": " << bytes << " B / pixel (" << bytes * renderer.width * renderer.height / (1024 * 1024)
+                  << " MB), geometry " << geometryMs / FRAMES << " ms, lighting " << lightingMs / FRAMES << " ms" << std::endl;
+    }
+    renderer.SetGBufferLayout(GBufferLayout::Standard);
+}
+
+// --bench-ssao: SSAO pass time (AO + blur + upsample) per resolution / sample count
+void runSSAOBenchmark(DeferredRenderer& renderer, int citySize) {
+    std::vector<CompactInstance> buildings;
+    generateCity(citySize, buildings);
+    InstancedMesh city(buildings);
+
+    ThreadPool pool;
+    LightSystem lights(&pool);
+    for (unsigned int i = 0; i < NR_LIGHTS; i++) lights.Add(glm::vec3(0.0f, 10.0f, 10.0f));
+    Camera street(glm::vec3(0.0f, 5.0f, 15.0f));
+
+    const int WARMUP = 10, FRAMES = 100;
+    std::cout << "SSAO benchmark, " << renderer.width << "x" << renderer.height << ", " << FRAMES << " frames" << std::endl;
+
+    int divisors[3] = { 1, 2, 4 };
+    int kernelSizes[3] = { 64, 32, 16 };
+    for (int q = 0; q < 3; q++) {
+        renderer.ssao->SetQuality(divisors[q], kernelSizes[q]);
+        double ssaoMs = 0.0;
+        for (int i = 0; i < WARMUP + FRAMES; i++) {
+            lights.Update(i * 0.016f, renderer.lightBuffer->Map(), renderer.lightBuffer->capacity);
+            renderer.UploadLights(lights, street);
+            renderer.RenderFrame(street, [&]() {
+                renderer.GetGeometryShader(city.layout)->use();
+                city.Draw();
+            }, []() {});
+            if (i >= WARMUP) ssaoMs += renderer.frameGraph->GetPassMilliseconds("SSAO");
+        }
+        std::cout << "  1/" << divisors[q] << " resolution, " << kernelSizes[q] << " samples: " << ssaoMs / FRAMES << " ms" << std::endl;
+    }
+    renderer.ssao->SetQuality(2, 32);
+}
+
+// --bench-ao: GPU time + error against a high sample GTAO reference, per AO method at full resolution
+void runAOBenchmark(DeferredRenderer& renderer, int citySize) {
+    std::vector<CompactInstance> buildings;
+    generateCity(citySize, buildings);
+    InstancedMesh city(buildings);
+    Camera street(glm::vec3(0.0f, 5.0f, 15.0f));
+
+    // static scene: one G-buffer for every method
+    renderer.BeginGeometryPass(street);
+    renderer.GetGeometryShader(city.layout)->use();
+    city.Draw();
+    renderer.EndGeometryPass();
+    glm::mat4 projection = renderer.GetProjection(street);
+    glm::mat4 view = street.GetViewMatrix();
+
+    size_t pixelCount = (size_t)renderer.width * renderer.height;
+    auto readAO = [&](unsigned int texture) {
+        std::vector<float> ao(pixelCount);
+        glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+        glGetTextureImage(texture, 0, GL_RED, GL_FLOAT, (GLsizei)(pixelCount * sizeof(float)), ao.data());
+        return ao;
+    };
+
+    SSAO* ssao = renderer.ssao;
+    GTAO* gtao = renderer.gtao;
+
+    // reference: 16 slices x 8 steps per side, no accumulation
+    gtao->sliceCount = 16; gtao->stepCount = 8; gtao->historyWeight = 0.0f;
+    gtao->ResetHistory();
+    gtao->Compute(renderer.gBuffer, projection, view);
+    std::vector<float> reference = readAO(gtao->GetAOTexture());
+
+    struct Method { const char* name; bool isGTAO; int a, b; float historyWeight; };
+    Method methods[5] = {
+        { "SSAO 64 taps         ", false, 64, 0, 0.0f },
+        { "SSAO 16 taps         ", false, 16, 0, 0.0f },
+        { "GTAO 2x4x2 taps      ", true, 2, 4, 0.0f },
+        { "GTAO 2x4x2 + temporal", true, 2, 4, 0.9f },
+        { "GTAO 4x4x2 + temporal", true, 4, 4, 0.9f },
+    };
+
+    GpuTimer timer;
+    const int WARMUP = 10, FRAMES = 100;
+    std::cout << "AO benchmark, " << renderer.width << "x" << renderer.height << ", " << FRAMES << " frames, error = mean |AO - reference|" << std::endl;
+    for (const Method& method : methods) {
+        double ms = 0.0;
+        unsigned int result = 0;
+        int taps = method.isGTAO ? method.a * method.b * 2 : method.a;
+        if (method.isGTAO) {
+            gtao->sliceCount = method.a; gtao->stepCount = method.b; gtao->historyWeight = method.historyWeight;
+            gtao->ResetHistory();
+        }
+        else {
+            ssao->SetQuality(1, method.a);
+        }
+
+        for (int i = 0; i < WARMUP + FRAMES; i++) {
+            timer.Begin();
+            if (method.isGTAO) {
+                gtao->Compute(renderer.gBuffer, projection, view);
+                // the next dispatch samples this one's imageStore output as history
+                glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+                result = gtao->GetAOTexture();
+            }
+            else {
+                ssao->Compute(renderer.gBuffer, projection, view);
+                ssao->Blur(renderer.gBuffer, projection, view);
+                result = ssao->GetSSAOTexture();
+            }
+            timer.End();
+            double frameMs = timer.Finish();
+            if (i >= WARMUP) ms += frameMs;
+        }
+
+        std::vector<float> ao = readAO(result);
+        double error = 0.0;
+        for (size_t p = 0; p < pixelCount; p++) error += std::abs(ao[p] - reference[p]);
+        std::cout << "  " << method.name << ": " << ms / FRAMES << " ms, " << taps << " taps / pixel / frame, error " << error / pixelCount << std::endl;
+        ssao->Release();
+    }
+
+    renderer.gBuffer->Release(renderer.targetPool);
+    ssao->SetQuality(2, 32);
+    gtao->sliceCount = 2; gtao->stepCount = 4; gtao->historyWeight = 0.9f;
+    gtao->ResetHistory();
+}
+
+// --test-gpu-cull: compute shader visible count vs the SSE frustum cull, both instance layouts
+bool runGPUCullTest(int citySize) {
+    std::vector<CompactInstance> compact;
+    generateCity(citySize, compact);
+    std::vector<glm::mat4> matrices;
+    for (const CompactInstance& building : compact) matrices.push_back(building.ToMatrix());
+    InstancedMesh matrixMesh(matrices);
+    InstancedMesh compactMesh(compact);
+
+    // overview, street level in four directions, looking at the sky, outside the city looking away
+    float cityExtent = citySize * 3.0f;
+    std::vector<Camera> cameras;
+    cameras.push_back(Camera(glm::vec3(0.0f, cityExtent, cityExtent * 1.5f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, -35.0f));
+    for (int i = 0; i < 4; i++) cameras.push_back(Camera(glm::vec3(1.5f, 2.0f, 1.5f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f + 90.0f * i, 0.0f));
+    cameras.push_back(Camera(glm::vec3(0.0f, 2.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, 89.0f));
+    cameras.push_back(Camera(glm::vec3(0.0f, 5.0f, cityExtent * 2.0f), glm::vec3(0.0f, 1.0f, 0.0f), 90.0f, 0.0f));
+
+    std::cout << "GPU culling test, " << compact.size() << " buildings, " << cameras.size() << " cameras" << std::endl;
+    bool passed = true;
+    InstancedMesh* meshes[2] = { &matrixMesh, &compactMesh };
+    const char* names[2] = { "mat4   ", "compact" };
+    for (int m = 0; m < 2; m++) {
+        for (size_t c = 0; c < cameras.size(); c++) {
+            glm::mat4 projection = glm::perspective(glm::radians(cameras[c].Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, cityExtent * 4.0f);
+            Frustum frustum(projection * cameras[c].GetViewMatrix());
+            meshes[m]->CullGPU(frustum);
+            meshes[m]->ReadBackGPUStats();
+            unsigned int cpu = meshes[m]->CountVisible(frustum);
+            bool ok = meshes[m]->visibleCount == cpu;
+            if (!ok) passed = false;
+            std::cout << "  " << names[m] << " camera " << c << ": GPU " << meshes[m]->visibleCount << ", CPU " << cpu
+                      << (ok ? "" : "   MISMATCH") << std::endl;
+        }
+    }
+    std::cout << (passed ? "PASSED" : "FAILED") << std::endl;
+    return passed;
+}
+
+int main(int argc, char** argv)
 {
+    // --bench-lights [count]: CPU light animation benchmark, no window
+    if (argc > 1 && strcmp(argv[1], "--bench-lights") == 0) {
+        unsigned int count = argc > 2 ? (unsigned int)atoi(argv[2]) : 100000;
+        LightSystem::RunBenchmark(count, 200);
+        return 0;
+    }
+    // --test-occlusion: conservativeness check of the occlusion culler, no window
+    if (argc > 1 && strcmp(argv[1], "--test-occlusion") == 0) {
+        return OcclusionCuller::RunSelfTest() ? 0 : 1;
+    }
+    // --test-city: chunk generation must not depend on thread count / order, no window
+    if (argc > 1 && strcmp(argv[1], "--test-city") == 0) {
+        return CityGenerator::RunDeterminismTest() ? 0 : 1;
+    }
+    // --test-frame-graph: pass ordering from reads / writes, no window
+    if (argc > 1 && strcmp(argv[1], "--test-frame-graph") == 0) {
+        return FrameGraph::RunSelfTest() ? 0 : 1;
+    }
+
+    // --bench-instances [citySize]: GPU benchmark in a hidden window
+    bool benchInstances = argc > 1 && strcmp(argv[1], "--bench-instances") == 0;
+    // --bench-gbuffer [citySize]: same, G-buffer layouts
+    bool benchGBuffer = argc > 1 && strcmp(argv[1], "--bench-gbuffer") == 0;
+    // --bench-ssao [citySize]: same, SSAO quality modes
+    bool benchSSAO = argc > 1 && strcmp(argv[1], "--bench-ssao") == 0;
+    // --bench-ao [citySize]: same, SSAO vs GTAO quality / performance
+    bool benchAO = argc > 1 && strcmp(argv[1], "--bench-ao") == 0;
+    // --test-gpu-cull [citySize]: GPU vs CPU frustum culling in a hidden window, exit code 1 on a mismatch
+    bool testGPUCull = argc > 1 && strcmp(argv[1], "--test-gpu-cull") == 0;
+    // --no-shader-cache (any position): compile every program, measures a cold start
+    for (int i = 1; i < argc; i++)
+        if (strcmp(argv[i], "--no-shader-cache") == 0) ShaderCache::enabled = false;
+
+    // startup = window creation .. end of the first frame (programs are resolved on first use)
+    auto startupBegin = std::chrono::steady_clock::now();
+    bool firstFrame = true;
+
     // GLFW init
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+    if (benchInstances || benchGBuffer || benchSSAO || benchAO || testGPUCull) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Cyberpunk Rendering", NULL, NULL);
@@ -60,6 +434,7 @@ int main()
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
+    glfwSetKeyCallback(window, key_callback);
 
 	// hide cursor
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -69,49 +444,59 @@ int main()
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    ShaderCache::Init((GLADloadproc)glfwGetProcAddress);
+
+    if (testGPUCull) {
+        bool passed = runGPUCullTest(argc > 2 ? atoi(argv[2]) : 50);
+        glfwTerminate();
+        return passed ? 0 : 1;
+    }
 
     glEnable(GL_DEPTH_TEST);
 
 	// Create Deferred Renderer
     DeferredRenderer renderer(SCR_WIDTH, SCR_HEIGHT);
-    skybox = new SkyboxRenderer();
+    rendererPtr = &renderer;
 
-    std::vector<glm::mat4> cityModels;
-    int CITY_SIZE = 20; // 20x20 street
-    float SPACING = 3.0f; // building spacing
+    // benchmarks measure the steady state: wait for the streamed textures
+    if (benchInstances || benchGBuffer || benchSSAO || benchAO)
+        renderer.textureStreamer->Flush();
 
-    srand(999);
-
-    for (int x = -CITY_SIZE; x < CITY_SIZE; x++) {
-        for (int z = -CITY_SIZE; z < CITY_SIZE; z++) {
-            // camera reserved
-            if (abs(x) < 2 && abs(z) < 2) continue;
-
-            glm::mat4 model = glm::mat4(1.0f);
-            
-            float posX = x * SPACING;
-            float posZ = z * SPACING;
-
-            // random height
-            float height = static_cast<float>(rand() % 5 + 1);
-            if (rand() % 100 > 90) height *= 4.0f;
-            if (rand() % 100 > 95) height *= 2.0f;
+    if (benchInstances) {
+        runInstanceBenchmark(renderer, argc > 2 ? atoi(argv[2]) : 100);
+        glfwTerminate();
+        return 0;
+    }
+    if (benchGBuffer) {
+        runGBufferBenchmark(renderer, argc > 2 ? atoi(argv[2]) : 20);
+        glfwTerminate();
+        return 0;
+    }
+    if (benchSSAO) {
+        runSSAOBenchmark(renderer, argc > 2 ? atoi(argv[2]) : 20);
+        glfwTerminate();
+        return 0;
+    }
+    if (benchAO) {
+        runAOBenchmark(renderer, argc > 2 ? atoi(argv[2]) : 20);
+        glfwTerminate();
+        return 0;
+    }
 
-            model = glm::translate(model, glm::vec3(posX, height / 2.0f, posZ));
+    skybox = new SkyboxRenderer(renderer.textureStreamer);
 
-            // scale
-            model = glm::scale(model, glm::vec3(2.0f, height, 2.0f));
-            cityModels.push_back(model);
-        }
-    }
+    // buildings are only translated + scaled: compact 32-byte instances
+    std::vector<CompactInstance> cityInstances;
+    srand(999);
+    generateCity(20, cityInstances); // 20x20 street
 
-    cityMesh = new InstancedMesh(cityModels);
-    lightPositions.clear();
-    lightColors.clear();
+    cityMesh = new InstancedMesh(cityInstances);
 
     // generate lights
-    lightPositions.clear();
-    lightColors.clear();
+    ThreadPool threadPool;
+    LightSystem lightSystem(&threadPool);
+    OcclusionCuller occlusionCuller(&threadPool);
+    cityStreamer = new CityStreamer(&threadPool);
 
     for (unsigned int i = 0; i < NR_LIGHTS; i++)
     {
@@ -121,10 +506,20 @@ int main()
         else if (type == 1) color = glm::vec3(1.0f, 0.0f, 1.0f); // Magenta
         else color = glm::vec3(0.5f, 0.0f, 1.0f); // Purple
 
-        lightColors.push_back(color * 10.0f);
-        lightPositions.push_back(glm::vec3(0.0f));
+        lightSystem.Add(color * 10.0f);
     }
 
+    std::vector<Vehicle> vehicles;
+    std::vector<CompactInstance> trafficInstances;
+    generateTraffic(NR_VEHICLES, vehicles, trafficInstances);
+    trafficMesh = new InstancedMesh(trafficInstances, true);
+
+    float titleTimer = 0.0f;
+    int titleFrames = 0;
+
+    // edits under assets/shaders are picked up while running
+    ShaderHotReload shaderHotReload;
+
     // Render Loop
     while (!glfwWindowShouldClose(window))
     {
@@ -132,68 +527,96 @@ int main()
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
-        processInput(window);
-
-        // light animation
-        for (unsigned int i = 0; i < lightPositions.size(); i++)
-        {
-            float time = currentFrame * 0.3f;
-            float offset = i * 10.0f;
-
-            // movement
-            float x = sin(time + offset) * 40.0f;
-            float z = cos(time * 0.5f + offset) * 40.0f;
-
-            // random height
-            float y = 2.0f + sin(time * 2.0f + i) * 2.0f + 2.0f;
-
-            lightPositions[i] = glm::vec3(x, y, z);
-        }
-
-        // --- Phase 1: Geometry ---
-        renderer.BeginGeometryPass(camera);
-        renderer.gBufferShader->setVec3("objectColor", glm::vec3(0.1f, 0.1f, 0.1f)); // �¦�j��
-        cityMesh->Draw();
-        renderer.EndGeometryPass();
-
-        // --- Phase 2: Lighting ---
-        renderer.BeginLightingPass(camera);
+        // frame boundary: swap in rebuilt programs
+        shaderHotReload.Update();
 
-        for (unsigned int i = 0; i < lightPositions.size(); i++) {
-            std::string iStr = std::to_string(i);
-            renderer.lightingShader->setVec3("lights[" + iStr + "].Position", lightPositions[i]);
-            renderer.lightingShader->setVec3("lights[" + iStr + "].Color", lightColors[i]);
+        processInput(window);
 
-            const float linear = 0.14f;
-            const float quadratic = 0.07f;
-            renderer.lightingShader->setFloat("lights[" + iStr + "].Linear", linear);
-            renderer.lightingShader->setFloat("lights[" + iStr + "].Quadratic", quadratic);
+        // light animation, written straight into this frame's light buffer region
+        lightSystem.Update(currentFrame, renderer.lightBuffer->Map(), renderer.lightBuffer->capacity);
+
+        // light clusters, read by the fog / lighting / forward passes
+        renderer.UploadLights(lightSystem, camera);
+
+        // Geometry -> SSAO -> Fog -> Lighting -> Forward -> Bloom -> Final (frame graph, culled per quality tier)
+        Frustum frustum(renderer.GetProjection(camera) * camera.GetViewMatrix());
+        auto drawGeometry = [&]() {
+            if (streamedCity) {
+                cityStreamer->Update(camera.Position);
+                Shader* geometryShader = renderer.GetGeometryShader(InstanceLayout::Compact);
+                geometryShader->use();
+                geometryShader->setVec3("objectColor", glm::vec3(0.1f, 0.1f, 0.1f)); // �¦�j��
+                cityStreamer->Draw(frustum);
+            }
+            else {
+                Shader* geometryShader = renderer.GetGeometryShader(cityMesh->layout);
+                geometryShader->use();
+                geometryShader->setVec3("objectColor", glm::vec3(0.1f, 0.1f, 0.1f)); // �¦�j��
+                if (gpuCulling) {
+                    cityMesh->CullGPU(frustum);
+                    geometryShader->use(); // compute pass changed the program
+                }
+                else if (occlusionCulling) {
+                    occlusionCuller.Begin(renderer.GetProjection(camera) * camera.GetViewMatrix());
+                    cityMesh->Cull(frustum, &occlusionCuller);
+                }
+                else {
+                    cityMesh->Cull(frustum);
+                }
+                cityMesh->Draw();
+            }
+
+            // traffic: every car moved, rewrite the instances (only the ring region in use is touched)
+            updateTraffic(currentFrame, vehicles, trafficInstances);
+            trafficMesh->UpdateInstances(0, trafficInstances.data(), trafficInstances.size());
+            Shader* trafficShader = renderer.GetGeometryShader(trafficMesh->layout);
+            trafficShader->use();
+            trafficShader->setVec3("objectColor", glm::vec3(0.15f, 0.15f, 0.18f));
+            trafficMesh->Cull(frustum);
+            trafficMesh->Draw();
+            trafficMesh->EndFrame();
+        };
+        auto drawForward = [&]() { skybox->Draw(camera); };
+        renderer.RenderFrame(camera, drawGeometry, drawForward);
+
+        // stats in the title bar, twice a second
+        titleTimer += deltaTime;
+        titleFrames++;
+        if (titleTimer >= 0.5f) {
+            std::string cityInfo;
+            if (streamedCity) {
+                cityInfo = "chunks: " + std::to_string(cityStreamer->drawnChunks) + " drawn, " + std::to_string(cityStreamer->residentChunks)
+                    + " resident, " + std::to_string(cityStreamer->pendingChunks) + " pending | buildings: " + std::to_string(cityStreamer->drawnInstances);
+            }
+            else {
+                std::string cullInfo = " culled (" + std::to_string(cityMesh->occludedCount) + " occluded)";
+                if (gpuCulling) {
+                    // cross-check against the CPU reference
+                    cityMesh->ReadBackGPUStats();
+                    cullInfo = " culled (GPU, CPU reference: " + std::to_string(cityMesh->CountVisible(frustum)) + " visible)";
+                }
+                cityInfo = "buildings: " + std::to_string(cityMesh->visibleCount) + " visible, " + std::to_string(cityMesh->culledCount) + cullInfo;
+            }
+            std::string title = "Cyberpunk Rendering | " + std::to_string((int)(titleFrames / titleTimer)) + " fps | " + cityInfo
+                + " | G-buffer " + std::to_string(renderer.frameGraph->GetPassMilliseconds("Geometry")).substr(0, 5) + " ms"
+                + " | targets " + std::to_string(renderer.targetPool->GetAllocatedBytes() >> 20) + " MB";
+            glfwSetWindowTitle(window, title.c_str());
+            titleTimer = 0.0f;
+            titleFrames = 0;
         }
-        renderer.EndLightingPass();
-
-        // --- Phase 3: Forward (Lights) ---
-
-        renderer.BeginForwardPass(camera);
-        for (unsigned int i = 0; i < lightPositions.size(); i++) {
-            glm::mat4 model = glm::mat4(1.0f);
-            model = glm::translate(model, lightPositions[i]);
-            model = glm::scale(model, glm::vec3(0.1f));
 
-            renderer.lightBoxShader->setMat4("model", glm::value_ptr(model));
-            renderer.lightBoxShader->setVec3("lightColor", lightColors[i]); // ���O�w�G�@�I
+        glfwSwapBuffers(window);
 
-            Primitives::renderCube();
+        if (firstFrame) {
+            glFinish();
+            ShaderCache::PrintStats(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupBegin).count());
+            firstFrame = false;
         }
-        skybox->Draw(camera);
-        renderer.EndForwardPass();
-
-        // --- Phase 4: Post Process ---
-        renderer.RenderPostProcess();
-
-        glfwSwapBuffers(window);
         glfwPollEvents();
     }
 
+    delete cityStreamer; // waits for in-flight chunk jobs
+    delete trafficMesh;
     glfwTerminate();
     return 0;
 }
@@ -211,6 +634,7 @@ void processInput(GLFWwindow* window) {
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
+    if (rendererPtr) rendererPtr->Resize(width, height);
 }
 
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
@@ -233,4 +657,78 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    if (action != GLFW_PRESS || rendererPtr == nullptr) return;
+
+    // L: switch lighting mode (clustered <-> light volumes)
+    if (key == GLFW_KEY_L) {
+        bool clustered = rendererPtr->lightingMode == LightingMode::Clustered;
+        rendererPtr->lightingMode = clustered ? LightingMode::LightVolumes : LightingMode::Clustered;
+        std::cout << "Lighting mode: " << (clustered ? "light volumes" : "clustered") << std::endl;
+    }
+
+    // G: switch building culling (CPU SIMD <-> GPU compute + indirect)
+    if (key == GLFW_KEY_G) {
+        gpuCulling = !gpuCulling;
+        std::cout << "Building culling: " << (gpuCulling ? "GPU" : "CPU") << std::endl;
+    }
+
+    // O: toggle CPU occlusion culling
+    if (key == GLFW_KEY_O) {
+        occlusionCulling = !occlusionCulling;
+        std::cout << "Occlusion culling: " << (occlusionCulling ? "on" : "off") << std::endl;
+    }
+
+    // P: switch G-buffer layout (standard <-> compact)
+    if (key == GLFW_KEY_P) {
+        bool compact = rendererPtr->gBuffer->layout == GBufferLayout::Compact;
+        rendererPtr->SetGBufferLayout(compact ? GBufferLayout::Standard : GBufferLayout::Compact);
+        std::cout << "G-buffer: " << (compact ? "standard" : "compact") << ", "
+                  << GBuffer::GetBytesPerPixel(rendererPtr->gBuffer->layout) << " B / pixel" << std::endl;
+    }
+
+    // Q: cycle quality tier (high -> low -> medium), the frame graph is rebuilt
+    if (key == GLFW_KEY_Q) {
+        RenderQuality next = rendererPtr->quality == RenderQuality::High ? RenderQuality::Low
+            : rendererPtr->quality == RenderQuality::Low ? RenderQuality::Medium : RenderQuality::High;
+        rendererPtr->SetQuality(next);
+        const char* names[3] = { "low (no AO, no bloom)", "medium (bloom)", "high (AO + bloom)" };
+        std::cout << "Quality: " << names[(int)next] << std::endl;
+    }
+
+    // H: cycle SSAO resolution (half -> quarter -> full), fewer samples at lower resolution
+    if (key == GLFW_KEY_H) {
+        SSAO* ssao = rendererPtr->ssao;
+        int divisor = ssao->resolutionDivisor == 2 ? 4 : ssao->resolutionDivisor == 4 ? 1 : 2;
+        ssao->SetQuality(divisor, 64 / divisor);
+        std::cout << "SSAO: 1/" << divisor << " resolution, " << ssao->kernelSize << " samples" << std::endl;
+    }
+
+    // M: switch AO method (SSAO <-> GTAO)
+    if (key == GLFW_KEY_M) {
+        bool gtao = rendererPtr->aoMode == AOMode::GTAO;
+        rendererPtr->SetAOMode(gtao ? AOMode::SSAO : AOMode::GTAO);
+        std::cout << "AO: " << (gtao ? "SSAO" : "GTAO") << std::endl;
+    }
+
+    // E: toggle auto exposure (luminance histogram) <-> fixed exposure
+    if (key == GLFW_KEY_E) {
+        rendererPtr->SetAutoExposure(!rendererPtr->autoExposureEnabled);
+        std::cout << "Auto exposure: " << (rendererPtr->autoExposureEnabled ? "on" : "off") << std::endl;
+    }
+
+    // T: print GPU time per frame graph pass
+    if (key == GLFW_KEY_T) {
+        for (const FrameGraph::PassTiming& timing : rendererPtr->frameGraph->GetTimings())
+            std::cout << "  " << timing.name << ": " << timing.milliseconds << " ms" << std::endl;
+    }
+
+    // C: switch city (streamed chunks <-> fixed instanced city)
+    if (key == GLFW_KEY_C) {
+        streamedCity = !streamedCity;
+        std::cout << "City: " << (streamedCity ? "streamed chunks" : "fixed") << std::endl;
+    }
 }
\ No newline at end of file